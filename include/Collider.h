@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace algomath
+{
+	enum COLLIDER_SHAPE
+	{
+		COLLIDER_PLANE = 0,
+		COLLIDER_SPHERE,
+		COLLIDER_BOX,
+		COLLIDER_CAPSULE,
+		NUM_COLLIDER_SHAPES
+	};
+
+	enum COLLISION_RESPONSE
+	{
+		COLLISION_BOUNCE = 0, // pushed back to the surface, reflected by bounce and slowed by friction
+		COLLISION_KILL,
+		NUM_COLLISION_RESPONSES
+	};
+
+	// a shape particles can't pass through, in the space the particles are simulated in.
+	// plain data, so .pest files can store it directly
+	struct Collider
+	{
+		int shape = COLLIDER_PLANE;
+		int response = COLLISION_BOUNCE;
+
+		glm::vec3 position = glm::vec3(0.0f); // centre, or any point on a plane
+		glm::vec3 rotation = glm::vec3(0.0f); // euler angles in degrees. a plane's normal and a capsule's axis are the rotated z axis
+
+		glm::vec3 halfExtents = glm::vec3(1.0f); // box
+		float radius = 1.0f; // sphere and capsule
+		float halfLength = 1.0f; // capsule, from the centre to the middle of either cap
+
+		float bounce = 0.5f; // share of the speed into the surface that comes back out of it
+		float friction = 0.1f; // share of the speed along the surface lost on every contact
+
+		template<class Archive>
+		void serialize(Archive & ar, const unsigned int version)
+		{
+			ar & shape;
+			ar & response;
+			ar & position;
+			ar & rotation;
+			ar & halfExtents;
+			ar & radius;
+			ar & halfLength;
+			ar & bounce;
+			ar & friction;
+		}
+	};
+
+	// a Collider with its rotation turned into axes, ready for the collision kernels
+	struct ColliderShape
+	{
+		int shape;
+		int response;
+		glm::vec3 centre;
+		glm::vec3 axes[3];
+		glm::vec3 halfExtents;
+		float radius;
+		float halfLength;
+		float bounce;
+		float friction;
+	};
+
+	ColliderShape prepareCollider(const Collider& collider);
+
+	const char* colliderShapeName(int shape);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Path.h"
+
+#define LOOKUP_TABLE_RESOLUTION 256
+#define LOOKUP_TABLE_MAX_ERROR 0.01f // KernelTests fails if a baked graph strays further than this from the original
+
+namespace algomath
+{
+	// a Path<float> graph resampled at LOOKUP_TABLE_RESOLUTION + 1 evenly spaced points over [0, 1].
+	// looking up is a clamp, an index and a lerp, no matter how many nodes the graph has
+	class LookupTable
+	{
+	public:
+		LookupTable(); // a straight line from 0 to 1, same as createDefaultTable
+
+		void bake(Path<float>& graph); // call again whenever the graph changes
+
+		// largest difference from graph.lookupValue, checked at samplesPerCell points between every pair of samples
+		float maxError(Path<float>& graph, unsigned int samplesPerCell = 8) const;
+
+		inline float lookup(float t) const
+		{
+			t = clamp(t, 0.0f, 1.0f) * LOOKUP_TABLE_RESOLUTION;
+			unsigned int i = (unsigned int)t;
+			if (i >= LOOKUP_TABLE_RESOLUTION)
+			{
+				i = LOOKUP_TABLE_RESOLUTION - 1;
+			}
+			return lerp(m_samples[i], m_samples[i + 1], t - (float)i);
+		}
+
+		const float* data() const { return m_samples; } // LOOKUP_TABLE_RESOLUTION + 1 floats, for gathering from SIMD code
+
+	private:
+		float m_samples[LOOKUP_TABLE_RESOLUTION + 1];
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#define PARTICLE_BUDGET_DEFAULT_PARTICLES 200000
+#define PARTICLE_BUDGET_DEFAULT_MS 4.0f // simulation time per frame, across every system
+#define PARTICLE_BUDGET_THROTTLE_STEP 0.125f // throttle change per adjustment, eight of them from untouched to fully throttled
+#define PARTICLE_BUDGET_RELAX 0.75f // throttles ease off once the frame costs less than this share of the budget
+#define PARTICLE_BUDGET_SMOOTHING 0.1f // weight of the newest frame in the averaged cost, so one slow frame doesn't throttle
+#define PARTICLE_BUDGET_SETTLE_FRAMES 10 // frames between throttle changes, for the average to show what the last one did
+#define PARTICLE_BUDGET_MIN_EMISSION 0.25f // emission scale of a fully throttled system
+
+class ParticleSystem;
+
+// what the budget knows about one ParticleSystem. priority goes in, the rest is what the budget measured and decided,
+// kept so the editor can show what each effect costs and how much it was held back
+struct ParticleBudgetState
+{
+	int priority = 0; // higher priorities get particles first and are throttled last
+
+	float simulateMs = 0.0f; // cost of the last frame's simulation
+	float averageMs = 0.0f; // smoothed over recent frames
+	unsigned int particlesAlive = 0;
+	unsigned int capacity = 0; // pool sizes of every emitter added up
+
+	float throttle = 0.0f; // 0 untouched to 1 fully throttled, scales emission down and the level of detail up
+	unsigned int particleQuota = ~0u; // most particles the system may have alive, its share of the global cap
+	uint64_t spawnsDenied = 0; // spawns the quota turned away
+	float throttledTime = 0.0f; // seconds spent throttled
+
+	float emissionScale() const { return 1.0f - (1.0f - PARTICLE_BUDGET_MIN_EMISSION) * throttle; }
+	unsigned int lodBias(unsigned int numLevels) const { return (unsigned int)(throttle * (numLevels - 1) + 0.5f); }
+};
+
+// caps the particles and simulation time of every ParticleSystem together. once a frame, after simulating, balance
+// looks at what the frame cost: over budget, the lowest priority system that can still be throttled is throttled a
+// step further, and comfortably under budget, the highest priority throttled system is let off a step. the global
+// particle cap is shared out by priority, each system reserving its whole capacity before the next gets any
+class ParticleBudget
+{
+public:
+	static ParticleBudget& global();
+
+	bool enabled = false;
+	unsigned int maxParticles = PARTICLE_BUDGET_DEFAULT_PARTICLES;
+	float frameBudgetMs = PARTICLE_BUDGET_DEFAULT_MS;
+
+	void balance(const std::vector<ParticleSystem*>& systems, float frameTime);
+
+	float getFrameMs() const { return m_frameMs; } // every system's simulation, last frame
+	float getAverageMs() const { return m_averageMs; }
+	unsigned int getParticlesAlive() const { return m_particlesAlive; }
+
+private:
+	float m_frameMs = 0.0f;
+	float m_averageMs = 0.0f;
+	unsigned int m_particlesAlive = 0;
+	unsigned int m_framesSinceChange = 0;
+
+	std::vector<ParticleSystem*> m_byPriority; // kept to avoid reallocating every frame
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <GLM\glm.hpp>
+#include <TTK\OBJMesh.h>
+
+// what the particle systems are being drawn for
+struct ParticleRenderView
+{
+	glm::mat4 viewMatrix = glm::mat4(1.0f);
+	glm::mat4 projectionMatrix = glm::mat4(1.0f);
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+	bool cullParticles = true; // test each particle against the frustum before drawing it
+	float minScreenSize = 0.0f; // smallest particle drawn, as a share of the screen's height. 0 draws every size
+};
+
+// an axis aligned box around particles. starts out empty, so adding to it is all that's needed to build one
+struct ParticleBounds
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool empty() const { return min.x > max.x; }
+	glm::vec3 centre() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+	void add(const glm::vec3& point);
+	void add(const ParticleBounds& other);
+	void expand(float distance);
+	ParticleBounds transformed(const glm::mat4& matrix) const; // still axis aligned, so it grows to fit a rotated box
+};
+
+// the six planes of a view's frustum, normals pointing inward, for deciding what is on screen
+struct ParticleFrustum
+{
+	glm::vec4 planes[6]; // left, right, bottom, top, near, far. xyz normalized, w the distance from the origin
+
+	explicit ParticleFrustum(const ParticleRenderView& view);
+
+	bool intersectsSphere(const glm::vec3& centre, float radius) const;
+	bool intersectsBox(const ParticleBounds& box) const; // empty boxes never intersect
+};
+
+// one drawn particle, already in world space
+struct ParticleInstance
+{
+	glm::mat4 matrix;
+	glm::vec4 colour;
+};
+
+// a run of instances that share a mesh. a null mesh draws TTK's sphere
+struct ParticleBatch
+{
+	TTK::OBJMesh* mesh;
+	unsigned int first;
+	unsigned int count;
+};
+
+// draw data for every emitter of every particle system, filled by ParticleSystem::render.
+// it holds copies, so the simulation is free to move on as soon as render returns
+class ParticleDrawList
+{
+public:
+	void clear(); // keeps the allocations for the next frame
+
+	void addCulled(unsigned int count) { m_numCulled += count; } // particles that were left out, for the statistics
+
+	// starts a batch for mesh (joining the last one if it uses the same mesh) and returns room for count instances
+	ParticleInstance* append(TTK::OBJMesh* mesh, unsigned int count);
+
+	// draws everything, grouped by mesh. has to be called from the thread that owns the GL context
+	void submit();
+
+	size_t numInstances() const { return m_instances.size(); }
+	size_t numBatches() const { return m_batches.size(); }
+	size_t numCulled() const { return m_numCulled; }
+
+private:
+	std::vector<ParticleInstance> m_instances;
+	std::vector<ParticleBatch> m_batches;
+	size_t m_numCulled = 0;
+};
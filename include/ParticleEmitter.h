@@ -7,9 +7,30 @@
 #include "NodeGrapher.h"
 #include "GameObject.h"
 #include <TTK\OBJMesh.h>
+#include "ParticlePool.h"
+#include "Random.h"
+#include "LookupTable.h"
+#include "SimulationClock.h"
+#include "SimulationTimeline.h"
+#include "ParticleBudget.h"
+#include "ParticleDrawList.h"
+#include "SpatialGrid.h"
+#include "Collider.h"
+#include "VectorField.h"
+#include "ParticleKernels.h"
 #include <map> // for std::map
 
 #define PRETTY_MUCH_ZERO 0.0000000001f
+#define PARTICLE_SPAWN_RANDOMS 12 // uniforms drawn by spawnParticle, see spawnParticle for how they are used
+#define PARTICLE_CHUNK_SIZE 4096 // particles per update job. fixed so results never depend on how many threads there are
+#define PARTICLE_PREWARM_STEP (1.0f / 20.0f) // step prewarm integrates with. coarse, but behaviours still settle
+#define PARTICLE_LOD_LEVELS 4 // level 0 is full detail
+#define PARTICLE_PREWARM_ANALYTIC_STEP 0.25f // analytic motion is exact at any step, which only decides when particles spawn and die
+#define PARTICLE_SPHERE_RADIUS 0.5f // radius TTK's sphere is drawn with for a particle of size 1
+#define PARTICLE_MESH_RADIUS 1.0f // generous radius for a particle mesh of size 1, meshes are modelled around unit size
+#define PARTICLE_BOUNDS_REBUILD_STEPS 30 // analytic updates between rebuilding the bounds, which only grow in between
+#define PARTICLE_AUTO_CAPACITY_HEADROOM 1.25f // auto capacity allows for this much more than the steady state count
+#define PARTICLE_AUTO_CAPACITY_MAX (1u << 22) // most particles auto capacity grows an emitter to
 
 class ParticleEmitter;
 class ParticleSystem;
@@ -22,53 +43,47 @@ enum EMISSION_SHAPE
 	NUM_EMISSION_SHAPES
 };
 
-struct Particle
+enum LOD_METRIC
 {
-	glm::mat4 worldMatrix;
-	Transform transform;
-
-	friend class ParticleEmitter;
-
-	glm::vec3 velocity;
-	glm::vec3 acceleration;
-	glm::vec3 force;
-	float mass;
-	glm::vec4 colour = glm::vec4(1.0f);
-
-	// Visual Properties
-	float sizeBegin;
-	float sizeEnd;
-	glm::vec4 colourBegin;
-	glm::vec4 colourEnd;
-	float speedLimitBegin;
-	float speedLimitEnd;
-
-	float life; // lifetime remaining in seconds
-	float lifespan;
-
-	float distanceTravelledAlongPath = 0.f;
+	LOD_DISTANCE = 0, // distance from the camera to the emitter
+	LOD_SCREEN_SIZE, // height of the emitter's bounds on screen, as a fraction of the screen's height
+	NUM_LOD_METRICS
+};
 
-	void update(float dt); // update position based off of forces/acceleration, and then resets them to 0
-						   // you can add acceleration or force or both
-						   // velocity will not reset each frame
-	
-	// Asset databases
-	std::shared_ptr<TTK::OBJMesh> mesh; //= std::make_shared<TTK::OBJMesh>();
+// how much of the simulation an emitter keeps at one level of detail
+struct ParticleLodLevel
+{
+	float distance; // the level starts this far away with LOD_DISTANCE. unused for level 0
+	float screenSize; // and below this screen size with LOD_SCREEN_SIZE
+	float emissionScale; // multiplies emissionRate
+	float capacityScale; // share of the pool new particles can fill. living particles are left to die off
+	unsigned int updateInterval; // steps between updates, each update takes the time of the steps skipped
+	bool reducedBehaviours; // no steering, seeking, path following, flocking or vector fields
 
-	void draw();
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version)
+	{
+		ar & distance;
+		ar & screenSize;
+		ar & emissionScale;
+		ar & capacityScale;
+		ar & updateInterval;
+		ar & reducedBehaviours;
+	}
+};
 
-	//return vectors to be added.
+namespace algomath
+{
+	// particle behaviours. each returns a vector to be added to the particle's force
 	//optimization: create versions of these that dont have to compute vectors to target or ranges
-	glm::vec3 seek(const glm::vec3& target, const float& strength);
-	glm::vec3 attract(const glm::vec3& target, const float& strength, const float& radius, const float & minRange = PRETTY_MUCH_ZERO); // move toward/away from target, but only within radius
-	glm::vec3 gravitate(const glm::vec3& target, const float& strength, const float& powerCap, const float & minRange = PRETTY_MUCH_ZERO); //power = scale / distance^2. capped power, min range within which produces a zero output.
-
-	
+	glm::vec3 seek(const glm::vec3& position, const glm::vec3& target, const float& strength);
+	glm::vec3 attract(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& target, const float& strength, const float& radius, const float & minRange = PRETTY_MUCH_ZERO); // move toward/away from target, but only within radius
+	glm::vec3 gravitate(const glm::vec3& position, const glm::vec3& target, const float& strength, const float& powerCap, const float & minRange = PRETTY_MUCH_ZERO); //power = scale / distance^2. capped power, min range within which produces a zero output.
 
 	//steering behaviours that take velocity into account
-	glm::vec3 steer(const glm::vec3& target, const float& strength, const float& powerCap); //like seek, but takes velocity into account
-	glm::vec3 arrive(const glm::vec3& target, const float& strength, const float& radius, const float& powerCap); //move toward target, slow down at the target
-};
+	glm::vec3 steer(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& target, const float& strength, const float& powerCap); //like seek, but takes velocity into account
+	glm::vec3 arrive(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& target, const float& strength, const float& radius, const float& powerCap); //move toward target, slow down at the target
+}
 
 class ParticleEmitter
 {
@@ -76,13 +91,59 @@ class ParticleEmitter
 	friend class ParticleSystem;
 private:
 	glm::mat4 worldMatrix;
-	Particle* particles;
+	ParticlePool particles;
 	float emissionTime = 0.0f; // keeps track of time passed to know how many particles need to be created
 	float timeRemaining;
-
-	void emitFromCuboid(Particle* p);
-	void emitFromSphere(Particle* p);
-	void emitFromFrustum(Particle* p);
+	float updateDt = 0.0f; // dt of the update in flight, between beginUpdate and endUpdate
+	unsigned int numUpdateChunks = 0;
+
+	algomath::CounterRandom random;
+	uint64_t spawnSerial = 0; // number of particles spawned since the random sequence was restarted, used as the particle's random stream
+	std::vector<float> spawnRandoms; // PARTICLE_SPAWN_RANDOMS per particle spawned this update, kept to avoid reallocating
+	algomath::SpatialGrid neighbourGrid; // snapshot of the particles at the start of the update, only built when flocking
+	std::vector<algomath::ColliderShape> colliderShapes; // myState.colliders as of the start of the update
+	algomath::VectorFieldSampler vectorFieldSampler = {}; // myState.vectorField as of the start of the update
+
+	// where particles were born and died this step, for the sub-emitters in Config. empty unless linked
+	ParticleEventBuffer birthEvents;
+	ParticleEventBuffer deathEvents;
+
+	unsigned int spawnBatch(unsigned int count); // returns the index of the first new particle
+	void recordEvent(ParticleEventBuffer& events, unsigned int idx);
+	void reserveEventBuffers();
+
+	bool prewarming = false; // spreads each step's spawns back over the step, so big steps don't spawn particles in clumps
+	void backdateSpawns(unsigned int first, unsigned int count, float dt);
+	float prewarmStep() const;
+
+	// level of detail, picked by selectLod. steps that time slicing skips add up in lodDt for the next update
+	unsigned int lodLevel = 0;
+	float lodDt = 0.0f;
+	unsigned int lodStepsPending = 0;
+	unsigned int lodLastUpdateSteps = 1; // how many steps the last update covered, for interpolating between updates
+	float sliceStep(float dt, uint64_t slot); // returns the dt to update with this step, 0 to skip it
+	float lodInterpolation(float interpolation) const; // the system's step interpolation, stretched over a sliced update
+
+	// box around the live particles' positions, in their own space. integration widens one box per chunk on the way
+	// and endUpdate merges them. analytic particles are never integrated, so each one adds the box its remaining flight
+	// fits in when it spawns, and the union is rebuilt every PARTICLE_BOUNDS_REBUILD_STEPS to let it shrink
+	ParticleBounds localBounds;
+	std::vector<float> chunkBounds; // min xyz then max xyz for every update chunk
+	unsigned int boundsRebuildCountdown = 0;
+	inline float* chunkBoundsFor(unsigned int begin) { return &chunkBounds[(size_t)(begin / PARTICLE_CHUNK_SIZE) * 6]; }
+	void addFlightBounds(unsigned int begin, unsigned int end, ParticleBounds& box) const; // analytic motion only
+	void rebuildBounds(); // from every live particle, for when something other than an update moved them
+	float maxParticleRadius() const;
+
+	// what ParticleBudget allows, handed down by the ParticleSystem each frame
+	float budgetEmissionScale = 1.0f;
+	unsigned int budgetLodBias = 0; // levels of detail to drop below the one selectLod picked
+	unsigned int budgetQuota = ~0u; // most particles this emitter may have alive
+	unsigned int budgetDenied = 0; // spawns the quota turned away since the system last collected them
+
+	void emitFromCuboid(unsigned int idx, const float* randoms);
+	void emitFromSphere(unsigned int idx, const float* randoms);
+	void emitFromFrustum(unsigned int idx, const float* randoms);
 
 	//these hacks are just for file I/O
 	std::vector<std::vector<algomath::NodeGraphTableEntry<glm::vec3>>> pathHack;
@@ -103,6 +164,9 @@ public:
 	void hacksToPaths();
 	void pathsToHacks();
 
+	void bakeGraphs(); // rebuilds the lookup tables from the size, speed and colour graphs
+	void loadVectorField(); // maps myState.vectorFieldFile, or generates curl noise from Config if there is no file
+
 	ParticleEmitter();
 	~ParticleEmitter();
 
@@ -111,20 +175,137 @@ public:
 	void killParticles();
 	void freeMemory();
 
+	// Config flags that decide which update kernels run. force and lifetime kernels each use their own group of bits
+	enum UPDATE_FLAGS
+	{
+		UPDATE_SEEK = 1 << 0,
+		UPDATE_STEER = 1 << 1,
+		UPDATE_GLOBAL_EFFECTS = 1 << 2,
+		UPDATE_FOLLOW_PATH = 1 << 3,
+		UPDATE_DIRECT_FOLLOW = 1 << 4,
+		UPDATE_SIZE_OVER_LIFETIME = 1 << 5,
+		UPDATE_COLOUR_OVER_LIFETIME = 1 << 6,
+		UPDATE_LIMIT_SPEED = 1 << 7,
+		UPDATE_FLOCK = 1 << 8, // not a kernel parameter, flocking is its own pass
+		UPDATE_VECTOR_FIELD = 1 << 9, // also its own pass
+		UPDATE_ANALYTIC = 1 << 10, // replaces integration with the closed form, see canUseAnalyticMotion
+
+		// behaviours that reduced levels of detail turn off
+		UPDATE_EXPENSIVE = UPDATE_SEEK | UPDATE_STEER | UPDATE_FOLLOW_PATH | UPDATE_DIRECT_FOLLOW | UPDATE_FLOCK | UPDATE_VECTOR_FIELD,
+		// behaviours that need the particles' current state, so analytic motion can't be used with them
+		UPDATE_NOT_ANALYTIC = UPDATE_SEEK | UPDATE_STEER | UPDATE_FOLLOW_PATH | UPDATE_FLOCK | UPDATE_VECTOR_FIELD | UPDATE_LIMIT_SPEED,
+
+		LIFETIME_FLAGS_SHIFT = 5,
+		LIFETIME_FLAGS_END = 8,
+		NUM_UPDATE_FLAG_BITS = 11
+	};
+
+	typedef void (ParticleEmitter::*ForceKernel)(unsigned int begin, unsigned int end, float dt);
+	typedef void (ParticleEmitter::*LifetimeKernel)(unsigned int begin, unsigned int end);
+
+	template<bool SEEK, bool STEER, bool GLOBAL_EFFECTS, bool FOLLOW_PATH, bool DIRECT_FOLLOW>
+	void accumulateForces(unsigned int begin, unsigned int end, float dt);
+	template<bool SIZE, bool COLOUR, bool LIMIT_SPEED>
+	void updateLifetime(unsigned int begin, unsigned int end);
+
 	void update(float dt);
-	void updateParticle(Particle* particle, const float& dt);
-	void draw();
+	// fast forwards by seconds in a few big steps, so a looping effect starts out already full. returns the milliseconds it took
+	float prewarm(float seconds);
+	unsigned int beginUpdate(float dt); // moves the emitter and spawns new particles, returns the number of chunks to update
+	void updateChunk(unsigned int chunk); // safe to call for different chunks at the same time
+	void endUpdate(); // removes particles that died this update
+	void updateParticles(unsigned int begin, unsigned int end, const float& dt);
+	void integrateParticles(unsigned int begin, unsigned int end, const float& dt);
+	void collideParticles(unsigned int begin, unsigned int end); // runs every collider over the range, after integration
+	void checkParticles(unsigned int begin, unsigned int end); // debug builds report NaN positions
+	void applyFlocking(unsigned int begin, unsigned int end); // separation, alignment and cohesion from neighbourGrid
+	void applyVectorField(unsigned int begin, unsigned int end); // samples myState.vectorField into the force
+	void prepareVectorField(); // loads the field if needed and works out where it is for this update
+
+	unsigned int getUpdateFlags() const;
+	void selectKernels(); // re-picks the update kernels if the Config flags changed
+
+	// analytic motion. with nothing but the uniform effects acting on them, a particle's position is a closed form of its
+	// spawn state and age, so the streams keep the spawn state and updates only age the particles
+	bool canUseAnalyticMotion(unsigned int flags) const; // false once anything that depends on the particle's current state is enabled
+	bool isAnalytic() const { return analyticMotion.active; }
+	glm::vec3 evaluatePosition(unsigned int idx, float age) const; // where particle idx is at age, in analytic mode
+	glm::vec3 evaluateVelocity(unsigned int idx, float age) const;
 
-	inline void spawnParticle(Particle* p);
+private:
+	// update kernels specialised for the current Config flags, see selectKernels
+	struct Kernels
+	{
+		unsigned int flags = ~0u; // never a real mask, so the first update always selects
+		ForceKernel forces = nullptr;
+		LifetimeKernel lifetime = nullptr;
+	} kernels;
+
+	// the constant motion the analytic streams were written for
+	struct AnalyticMotion
+	{
+		bool active = false;
+		glm::vec3 acceleration = glm::vec3(0.0f);
+		glm::vec3 force = glm::vec3(0.0f);
+	} analyticMotion;
+
+	void syncAnalyticMotion(); // switches the streams in or out of analytic form when the motion changes
+	void bakeAnalyticMotion(); // writes every particle's current position and velocity back into the streams
+	void rebaseAnalyticMotion(); // turns the current positions and velocities into the spawn state that leads to them
+	inline float particleAge(unsigned int idx) const { return particles.lifespan[idx] - particles.life[idx]; }
+	void renderAnalytic(const algomath::CullView* cullView, float interpolation, ParticleDrawList& drawList) const; // render, evaluating every particle at its age. cullView is nullptr to draw everything
+	void makeCullView(const ParticleRenderView& view, ParticleFrustum frustum, float interpolation, algomath::CullView& cullView) const;
+
+	// render's scratch space, kept to avoid reallocating every frame
+	mutable std::vector<unsigned int> cullVisible;
+	mutable Vec3Stream analyticPosition; // where analytic particles are drawn this frame
+	mutable std::vector<float> analyticSize;
+	mutable unsigned int lastDrawn = 0;
+	mutable unsigned int lastCulled = 0;
+
+public:
+	// adds every live particle to drawList. interpolation blends from the previous step's positions (0) to the current ones (1)
+	void render(const ParticleRenderView& view, float interpolation, ParticleDrawList& drawList) const;
+	unsigned int getNumDrawn() const { return lastDrawn; } // as of the last render
+	unsigned int getNumCulled() const { return lastCulled; }
 
-	void applyPathSteering(const float& dt, Particle* particle);
-	void applyDirectPathFollow(const float& dt, Particle* particle);
+	// world space box every live particle is drawn inside, kept up to date by updates. estimateBounds stands in while
+	// there are no particles, so an emitter that is about to start can be culled or indexed as well
+	ParticleBounds getBounds() const;
+	ParticleBounds estimateBounds() const; // from the emission shape, speed, lifetime and uniform effects in Config
+
+	inline void spawnParticle(unsigned int idx, const float* randoms);
+
+	void applyPathSteering(const float& dt, unsigned int idx);
+	void applyDirectPathFollow(const float& dt, unsigned int idx);
 
 
 	unsigned int getNumParticles() { return myConfig.numberOfParticles; }
+	unsigned int getNumAliveParticles() { return particles.numAlive(); }
 	glm::vec3 getParticlePosition(unsigned int idx);
 
-	void setNumParticles(unsigned int numParticles);
+	void setNumParticles(unsigned int numParticles); // keeps the particles that are alive, see ParticlePool::setCapacity
+	void reserveParticles(unsigned int count) { particles.reserve(count); } // allocates ahead for an effect known to grow
+	void shrinkParticles() { particles.shrinkToFit(); } // gives back the pool's room past numberOfParticles
+	unsigned int getNumAllocatedParticles() const { return particles.allocated(); }
+	size_t getParticleMemory() const { return particles.bytesAllocated(); }
+	unsigned int autoCapacity() const; // the capacity autoCapacity grows to
+
+	// picks the level of detail for a view, moving a level only once the metric is lodHysteresis past the threshold.
+	// emitters whose bounds are off screen drop to the last level
+	void selectLod(const ParticleRenderView& view);
+	unsigned int getLodLevel() const { return lodLevel; }
+	const ParticleLodLevel& activeLod() const; // full detail when LOD is off
+
+	// everything a step changes, for SimulationTimeline checkpoints. Config is not included, so edits survive a seek
+	size_t stateSize() const;
+	size_t stateSize(const uint8_t* state, size_t available) const; // bytes a saved state takes, 0 if available is too short to be one
+	void saveState(uint8_t* out) const;
+	void loadState(const uint8_t* in); // also goes back to the capacity the state was saved with
+
+	void setRandomSeed(unsigned int seed); // also restarts the random sequence, so the effect replays identically
+	void spawnFromEvents(const ParticleEventBuffer& events); // as many as fit, particlesPerEvent at each event
+	void restartRandom();
 
 	void setLifeRange(float min, float max);
 
@@ -139,12 +320,24 @@ public:
 		algomath::Path<float> speedGraph;
 		algomath::Path<float> colourGraph;
 
+		// the graphs above baked for fast lookups. call bakeGraphs after changing a graph
+		algomath::LookupTable sizeCurve;
+		algomath::LookupTable speedCurve;
+		algomath::LookupTable colourCurve;
+
 		//std::map<std::string, std::shared_ptr<TTK::MeshBase>> meshes;
 		std::map<std::string, std::shared_ptr<TTK::OBJMesh>> meshes;
+		std::shared_ptr<TTK::OBJMesh> particleMesh; // shared by every particle this emitter draws
+
+		std::vector<algomath::Collider> colliders; // in the same space as the particles
+
+		std::shared_ptr<algomath::VectorField> vectorField; // loaded on the first update that needs it
+		std::string vectorFieldFile; // .vfld to map, empty to generate curl noise instead
 	} myState;
 
 	struct Config {
 		unsigned int numberOfParticles;
+		bool autoCapacity = false; // grows numberOfParticles to what emissionRate and lifeRange.y keep alive
 
 		////emitter properties///////////////////////////////////////////////////////////////////////
 		glm::vec3 rotationalVelocity;
@@ -161,6 +354,29 @@ public:
 		float frustumRadiusTarget = 2.0f; //second circle, the part where vectors head toward
 		float frustumHeight = 3.0f;
 
+		unsigned int randomSeed = 0; // every spawn draws from a random stream derived from this and the particle's spawn number
+
+		// sub-emitters, indices of other emitters in the same system that spawn where this emitter's particles are born or die. -1 for none
+		int birthSubEmitter = -1;
+		int deathSubEmitter = -1;
+		// how this emitter spawns when it is someone's sub-emitter
+		unsigned int particlesPerEvent = 10;
+		float inheritVelocity = 0.0f; // share of the event particle's velocity added to the new particles
+
+		// evaluate positions in closed form instead of integrating them, whenever canUseAnalyticMotion allows
+		bool analyticMotion = false;
+
+		// level of detail
+		bool lodEnabled = false;
+		int lodMetric = LOD_DISTANCE;
+		float lodHysteresis = 0.1f; // share of a threshold the metric has to pass it by before the level changes
+		ParticleLodLevel lodLevels[PARTICLE_LOD_LEVELS] = {
+			{ 0.0f, 0.0f, 1.0f, 1.0f, 1, false },
+			{ 50.0f, 0.25f, 0.5f, 0.75f, 2, false },
+			{ 150.0f, 0.08f, 0.25f, 0.5f, 4, true },
+			{ 400.0f, 0.02f, 0.1f, 0.25f, 8, true },
+		};
+
 		///// Playback properties
 		bool playing = true;
 		bool loop = true;
@@ -192,6 +408,22 @@ public:
 		glm::vec3 globalForceVector = glm::vec3(0.0f, 0.0f, 0.0f);
 		glm::vec3 globalAccelerationVector = glm::vec3(0.0f, 0.0f, -10.0f);
 
+		// flocking stuff, particles react to the other particles of this emitter within flockRadius
+		bool flockingBehaviours = false;
+		bool mortonOrderGrid = true; // see SpatialGrid::build
+		float flockRadius = 5.0f; // also the neighbour grid's cell size
+		float separationRadius = 2.0f;
+		float separationForce = 0.f, alignmentForce = 0.f, cohesionForce = 0.f, flockMaxForce = 0.f;
+		unsigned int flockMaxNeighbours = 32; // stop looking after this many, 0 for no limit
+
+		// vector field stuff. the field fills the unit cube around vectorFieldTransform's origin, so its scale is the field's size
+		bool vectorFieldEffects = false;
+		int vectorFieldMode = algomath::VECTOR_FIELD_FORCE;
+		float vectorFieldStrength = 10.0f;
+		unsigned int vectorFieldResolution = 32; // samples per axis of generated curl noise
+		float vectorFieldFrequency = 3.0f; // noise cells across generated curl noise
+		Transform vectorFieldTransform;
+
 		///// Initial properties for newly spawned particles //////////////////////////////////////////////////////////////////////
 		// these properties are single floats, so we can pack the min and max into a vec2, just data!
 		bool limitSpeedOverLifetime = false;
@@ -236,6 +468,10 @@ public:
 		ar &myConfig.numberOfParticles;
 		ar &myConfig.emissionShape;
 		ar &myConfig.emissionRate;
+		if (version >= 2)
+		{
+			ar &myConfig.randomSeed;
+		}
 
 		//cuboid
 		ar &myConfig.boxSize; // size of the emitter box
@@ -293,6 +529,67 @@ public:
 		ar &myConfig.globalForceVector;
 		ar &myConfig.globalAccelerationVector;
 
+		if (version >= 3)
+		{
+			ar &myConfig.flockingBehaviours;
+			ar &myConfig.mortonOrderGrid;
+			ar &myConfig.flockRadius;
+			ar &myConfig.separationRadius;
+			ar &myConfig.separationForce;
+			ar &myConfig.alignmentForce;
+			ar &myConfig.cohesionForce;
+			ar &myConfig.flockMaxForce;
+			ar &myConfig.flockMaxNeighbours;
+		}
+
+		if (version >= 4)
+		{
+			ar &myState.colliders;
+		}
+
+		if (version >= 5)
+		{
+			ar &myConfig.vectorFieldEffects;
+			ar &myConfig.vectorFieldMode;
+			ar &myConfig.vectorFieldStrength;
+			ar &myConfig.vectorFieldResolution;
+			ar &myConfig.vectorFieldFrequency;
+			ar &myConfig.vectorFieldTransform;
+			ar &myState.vectorFieldFile;
+			myState.vectorField.reset(); // reloaded on the next update
+		}
+
+		if (version >= 6)
+		{
+			ar &myConfig.birthSubEmitter;
+			ar &myConfig.deathSubEmitter;
+			ar &myConfig.particlesPerEvent;
+			ar &myConfig.inheritVelocity;
+		}
+
+		if (version >= 7)
+		{
+			ar &myConfig.analyticMotion;
+		}
+
+		if (version >= 8)
+		{
+			ar &myConfig.lodEnabled;
+			ar &myConfig.lodMetric;
+			ar &myConfig.lodHysteresis;
+			if (version < 10)
+			{
+				float lodBoundsRadius; // the screen size metric measures the bounds now
+				ar &lodBoundsRadius;
+			}
+			ar &myConfig.lodLevels;
+		}
+
+		if (version >= 9)
+		{
+			ar &myConfig.autoCapacity;
+		}
+
 		///// Initial properties for newly spawned particles //////////////////////////////////////////////////////////////////////
 		ar &myConfig.initialSpeedRange;
 
@@ -318,16 +615,48 @@ public:
 	}
 };
 
-BOOST_CLASS_VERSION(ParticleEmitter, 1)
+BOOST_CLASS_VERSION(ParticleEmitter, 10)
 
 class ParticleSystem : public Component //encapsulates an entire visual effect
 {
 public:
 	ParticleSystem();
 	~ParticleSystem();
+	ParticleSystem(const ParticleSystem&) = delete; // the emitters are owned and the system is registered in s_systems
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
 
-	void update();
+	void update(); // Component update, simulates the time given to setFrameTime
+	void simulate(float frameTime); // advances the clock by frameTime and runs however many fixed steps that makes
+	void render(const ParticleRenderView& view, ParticleDrawList& drawList); // adds this system's particles, doesn't draw anything
 	void clearSystem();
+
+	// render for every ParticleSystem in existence, so one submit draws them all
+	static void renderAll(const ParticleRenderView& view, ParticleDrawList& drawList);
+
+	void selectLod(const ParticleRenderView& view); // picks every emitter's level of detail, before simulating
+	static void selectLodAll(const ParticleRenderView& view);
+
+	ParticleBounds getBounds() const; // every emitter's bounds together, in world space
+
+	void setFrameTime(float frameTime) { m_frameTime = frameTime; }
+	ParticleBudgetState budget; // priority goes in, costs and throttling come out, see ParticleBudget
+	void applyBudget(); // passes budget's throttle and quota on to the emitters
+
+	// ParticleBudget::balance over every system. call once a frame after simulating
+	static void balanceBudget(float frameTime);
+	static const std::vector<ParticleSystem*>& allSystems() { return s_systems; }
+	SimulationClock clock;
+	SimulationTimeline timeline; // checkpoints taken as the system steps, once enabled
+
+	// restores the newest checkpoint at or before time and simulates from there, at most one checkpoint interval.
+	// returns false if there is no checkpoint that early or the emitters changed since it was taken
+	bool seek(float time);
+
+	// prewarm for the whole system, every emitter stepping together so sub-emitters get their events.
+	// uses the smallest step any emitter needs, returns the milliseconds it took
+	float prewarm(float seconds);
+	unsigned int prewarmSteps(float seconds) const; // steps prewarm takes for seconds
+	float getTime() const { return m_step * clock.getFixedStep(); } // simulated time since the timeline started
 	
 	void removeAt(size_t index);
 
@@ -345,6 +674,18 @@ public:
 		ar & m_emitters;
 	}
 private:
+	void step(float dt); // one fixed simulation step of every emitter
+	void dispatchEvents(); // sub-emitters spawn from the events recorded this step
+
+	float m_frameTime = 0.0f;
+	uint64_t m_step = 0; // steps simulated, the timeline's clock
+	bool m_seeking = false; // steps taken by seek replay checkpoints that already exist, so they aren't recorded again
+	std::vector<uint8_t> m_timelineState;
+
+	void saveState(std::vector<uint8_t>& state) const;
+	bool loadState(const std::vector<uint8_t>& state);
+	static std::vector<ParticleSystem*> s_systems; // every live system, for renderAll
+	std::vector<std::pair<ParticleEmitter*, unsigned int>> m_updateJobs; // (emitter, chunk) pairs, kept to avoid reallocating every frame
 };
 
 void drawMat4(const glm::mat4& t, const float& scale = 1.0f);
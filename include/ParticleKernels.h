@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Collider.h"
+#include "VectorField.h"
+
+// batched particle math that runs over ParticlePool streams rather than one particle at a time.
+// every kernel has a scalar version plus SSE2 and AVX2 versions; the widest one the cpu supports is picked once at startup
+namespace algomath
+{
+	enum SIMD_LEVEL
+	{
+		SIMD_SCALAR = 0,
+		SIMD_SSE2,
+		SIMD_AVX2,
+		NUM_SIMD_LEVELS
+	};
+
+	// raw stream pointers for the integration pass. all arrays are indexed by particle
+	struct IntegrationStreams
+	{
+		float* posX;
+		float* posY;
+		float* posZ;
+		float* velX;
+		float* velY;
+		float* velZ;
+		float* accelX;
+		float* accelY;
+		float* accelZ;
+		float* forceX;
+		float* forceY;
+		float* forceZ;
+		const float* mass;
+		float* life;
+		const float* speedLimit; // nullptr when speed is not limited
+		float* bounds; // nullptr, or min xyz then max xyz, widened to take in every position before and after the step
+	};
+
+	// for every particle in [begin, end):
+	// acceleration += force / mass, velocity += acceleration * dt, clamp speed, position += velocity * dt,
+	// then force and acceleration are reset and life is reduced by dt.
+	// the bounds reduction rides along with the position update, so keeping an emitter's bounds costs no extra pass
+	typedef void(*IntegrateKernel)(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt);
+
+	void integrateParticlesScalar(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt);
+	void integrateParticlesSSE2(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt);
+	void integrateParticlesAVX2(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt);
+
+	SIMD_LEVEL detectSimdLevel(); // queries cpuid, and the OS for AVX state support
+	SIMD_LEVEL activeSimdLevel(); // the level the dispatched kernels were chosen for
+	const char* simdLevelName(SIMD_LEVEL level);
+
+	void integrateParticles(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt); // dispatches to the best kernel
+
+	// widens bounds (min xyz then max xyz) to take in positions [begin, end). for positions moved after integration
+	void boundParticles(const float* posX, const float* posY, const float* posZ, unsigned int begin, unsigned int end, float* bounds);
+
+	// raw stream pointers for the collision pass
+	struct CollisionStreams
+	{
+		float* posX;
+		float* posY;
+		float* posZ;
+		float* velX;
+		float* velY;
+		float* velZ;
+		float* life;
+	};
+
+	// moves every particle in [begin, end) that ended up inside collider back out and applies its response.
+	// the wide kernels only find the particles that are inside; the few that are get resolved one at a time
+	typedef void(*CollideKernel)(const CollisionStreams& streams, const ColliderShape& collider, unsigned int begin, unsigned int end);
+
+	void collideParticlesScalar(const CollisionStreams& streams, const ColliderShape& collider, unsigned int begin, unsigned int end);
+	void collideParticlesSSE2(const CollisionStreams& streams, const ColliderShape& collider, unsigned int begin, unsigned int end);
+
+	void collideParticles(const CollisionStreams& streams, const ColliderShape& collider, unsigned int begin, unsigned int end); // dispatches to the best kernel
+
+	// a loaded VectorField plus where it sits, everything the sampling kernels need
+	struct VectorFieldSampler
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		int size[3];
+		float toGrid[3][4]; // rows of the affine map from particle space to grid coordinates, [0, size - 1] inside the field
+		float strength;
+		int mode; // a VECTOR_FIELD_MODE
+	};
+
+	// raw stream pointers for the vector field pass
+	struct VectorFieldStreams
+	{
+		const float* posX;
+		const float* posY;
+		const float* posZ;
+		const float* velX;
+		const float* velY;
+		const float* velZ;
+		float* forceX;
+		float* forceY;
+		float* forceZ;
+	};
+
+	// samples the field trilinearly at every particle in [begin, end) that is inside it and adds strength times the
+	// sample to its force. in velocity mode the particle's own velocity is subtracted, so it gets pushed toward the field
+	typedef void(*VectorFieldKernel)(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end);
+
+	void applyVectorFieldScalar(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end);
+	void applyVectorFieldSSE2(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end);
+	void applyVectorFieldAVX2(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end);
+
+	void applyVectorField(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end); // dispatches to the best kernel
+
+	// raw stream pointers for the culling pass
+	struct CullStreams
+	{
+		const float* posX;
+		const float* posY;
+		const float* posZ;
+		const float* prevX; // drawn positions are blended from these to pos, the same pointers as pos for no blending
+		const float* prevY;
+		const float* prevZ;
+		const float* size; // scales the bounding sphere's radius
+	};
+
+	// what the particles are culled against
+	struct CullView
+	{
+		float planes[6][4]; // frustum planes in the particles' space, left unnormalized so they give world space distances. [4] is the near plane
+		float interpolation; // how far from prev to pos the particles are drawn
+		float radiusScale; // radius of a particle of size 1 in world space
+		float sizeFactor; // projection[1][1] over the smallest screen size drawn. a particle is too small once radius * sizeFactor is less than its near plane distance. 0 draws any size
+	};
+
+	// writes the index of every particle in [begin, end) whose bounding sphere touches the frustum and is big enough on
+	// screen to visible, in order, and returns how many there are. visible needs room for end - begin indices
+	typedef unsigned int(*CullKernel)(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible);
+
+	unsigned int cullParticlesScalar(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible);
+	unsigned int cullParticlesSSE2(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible);
+	unsigned int cullParticlesAVX2(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible);
+
+	unsigned int cullParticles(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible); // dispatches to the best kernel
+
+	// milliseconds the dispatched kernel takes to run one collider of the given shape over count particles, best of repeats
+	float benchmarkCollideKernel(int shape, unsigned int count = 100000, unsigned int repeats = 20);
+
+	// for timing code that can't include <chrono> itself, being compiled as managed
+	double timeMilliseconds();
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <vector>
+#include <new> // for std::bad_alloc
+#include <cstdint>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include "Path.h"
+
+#if defined(_MSC_VER)
+#include <malloc.h> // for _aligned_malloc
+#endif
+
+#define PARTICLE_STREAM_ALIGNMENT 64 // a cache line, and a multiple of every SIMD width the kernels use
+#define PARTICLE_POOL_SHRINK_RATIO 4 // streams are only reallocated smaller once capacity needs less than a quarter of them
+
+// std::allocator, but every block starts on an ALIGNMENT byte boundary
+template<class T, size_t ALIGNMENT>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	template<class U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, ALIGNMENT> other;
+	};
+
+	AlignedAllocator() {}
+	template<class U>
+	AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+	T* allocate(size_t n)
+	{
+		if (n == 0)
+		{
+			return nullptr;
+		}
+#if defined(_MSC_VER)
+		void* block = _aligned_malloc(n * sizeof(T), ALIGNMENT);
+#else
+		void* block = nullptr;
+		if (posix_memalign(&block, ALIGNMENT, n * sizeof(T)) != 0)
+		{
+			block = nullptr;
+		}
+#endif
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(block);
+	}
+
+	void deallocate(T* block, size_t)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(block);
+#else
+		free(block);
+#endif
+	}
+};
+
+template<class T, class U, size_t ALIGNMENT>
+inline bool operator==(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&) { return true; }
+template<class T, class U, size_t ALIGNMENT>
+inline bool operator!=(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&) { return false; }
+
+// one per-particle property
+template<class T>
+using ParticleStream = std::vector<T, AlignedAllocator<T, PARTICLE_STREAM_ALIGNMENT>>;
+
+// three tightly packed float arrays, one per component.
+// kernels that only care about x, y and z can stream them without touching anything else
+struct Vec3Stream
+{
+	ParticleStream<float> x;
+	ParticleStream<float> y;
+	ParticleStream<float> z;
+
+	inline glm::vec3 get(size_t idx) const
+	{
+		return glm::vec3(x[idx], y[idx], z[idx]);
+	}
+
+	inline void set(size_t idx, const glm::vec3& v)
+	{
+		x[idx] = v.x;
+		y[idx] = v.y;
+		z[idx] = v.z;
+	}
+
+	inline void add(size_t idx, const glm::vec3& v)
+	{
+		x[idx] += v.x;
+		y[idx] += v.y;
+		z[idx] += v.z;
+	}
+};
+
+// positions and velocities of particles that were born or died during a step, for sub-emitters to spawn from.
+// sized from the pool's capacity, which no step can exceed, so recording an event never allocates
+struct ParticleEventBuffer
+{
+	Vec3Stream position;
+	Vec3Stream velocity;
+	unsigned int count = 0;
+
+	void reserve(unsigned int capacity); // reallocates, any recorded events are lost. 24 bytes per event
+	unsigned int capacity() const { return (unsigned int)position.x.size(); }
+
+	inline void push(const glm::vec3& p, const glm::vec3& v)
+	{
+		if (count < capacity())
+		{
+			position.set(count, p);
+			velocity.set(count, v);
+			++count;
+		}
+	}
+
+	void clear() { count = 0; }
+};
+
+// structure-of-arrays particle storage. every per-particle property lives in its own contiguous stream,
+// so an update pass only pulls in the properties it actually reads or writes.
+// living particles are always packed into [0, numAlive), so nothing ever has to skip over dead slots.
+// capacity is how many particles may be alive, the streams can be allocated for more: they grow by half again
+// whenever capacity outgrows them and only shrink once mostly unused, so dragging capacity around in the editor
+// reallocates a handful of times instead of every frame. living particles survive every change
+class ParticlePool
+{
+public:
+	ParticlePool();
+	~ParticlePool();
+
+	void setCapacity(unsigned int capacity); // particles past a smaller capacity die, the rest are kept
+	void reserve(unsigned int count); // allocates room for count particles up front, without changing capacity
+	void shrinkToFit(); // reallocates the streams to exactly capacity
+	void clear(); // releases all memory
+
+	unsigned int capacity() const { return m_capacity; }
+	unsigned int allocated() const { return m_allocated; } // particles the streams have room for, at least capacity
+	size_t bytesAllocated() const;
+	unsigned int numAlive() const { return m_numAlive; }
+	bool full() const { return m_numAlive >= m_capacity; }
+
+	unsigned int spawn(); // O(1), returns the index of a new particle at the end of the alive range. check full() first!
+	void kill(unsigned int idx); // O(1), moves the last living particle into idx
+	void killAll() { m_numAlive = 0; }
+
+	void copyParticle(unsigned int dst, unsigned int src);
+
+	// snapshots of the whole pool for SimulationTimeline. every stream is written at full capacity with the dead slots
+	// zeroed, so a stream starts at the same offset in every snapshot and unchanged particles line up byte for byte.
+	// the capacity is saved too, and loadState sets it
+	size_t stateSize() const { return stateSize(m_capacity); }
+	size_t stateSize(unsigned int capacity) const;
+	void saveState(uint8_t* out) const;
+	void loadState(const uint8_t* in);
+	static unsigned int savedCapacity(const uint8_t* in); // the capacity a state was saved with
+
+	// simulation state
+	Vec3Stream position;
+	Vec3Stream previousPosition; // position before the last simulation step, draw interpolates between the two
+	Vec3Stream velocity;
+	Vec3Stream acceleration; // accumulated each update, reset after integration
+	Vec3Stream force; // accumulated each update, reset after integration
+	ParticleStream<float> mass;
+	ParticleStream<float> life; // lifetime remaining in seconds
+	ParticleStream<float> lifespan;
+	ParticleStream<float> distanceTravelledAlongPath;
+	ParticleStream<algomath::PathCursor> pathCursor; // where distanceTravelledAlongPath was last found on the path
+	ParticleStream<algomath::PathCursor> lookAheadCursor; // same for the steering target ahead of the particle
+
+	// visual properties
+	ParticleStream<float> size; // current uniform scale
+	ParticleStream<float> sizeBegin;
+	ParticleStream<float> sizeEnd;
+	ParticleStream<glm::vec4> colour;
+	ParticleStream<glm::vec4> colourBegin;
+	ParticleStream<glm::vec4> colourEnd;
+	ParticleStream<float> speedLimitBegin;
+	ParticleStream<float> speedLimitEnd;
+	ParticleStream<float> speedLimit; // current cap, written before the integration kernel runs
+
+private:
+	unsigned int m_capacity;
+	unsigned int m_allocated;
+	unsigned int m_numAlive;
+
+	void reallocate(unsigned int count); // moves the living particles into streams of exactly count
+
+	// calls f on every per-particle stream, so adding a stream only means listing it here
+	template<class F>
+	void forEachStream(F f) { forEachStreamOf(*this, f); }
+	template<class F>
+	void forEachStream(F f) const { forEachStreamOf(*this, f); }
+
+	template<class Pool, class F>
+	static void forEachStreamOf(Pool& pool, F& f)
+	{
+		f(pool.position.x); f(pool.position.y); f(pool.position.z);
+		f(pool.previousPosition.x); f(pool.previousPosition.y); f(pool.previousPosition.z);
+		f(pool.velocity.x); f(pool.velocity.y); f(pool.velocity.z);
+		f(pool.acceleration.x); f(pool.acceleration.y); f(pool.acceleration.z);
+		f(pool.force.x); f(pool.force.y); f(pool.force.z);
+		f(pool.mass);
+		f(pool.life);
+		f(pool.lifespan);
+		f(pool.distanceTravelledAlongPath);
+		f(pool.pathCursor);
+		f(pool.lookAheadCursor);
+
+		f(pool.size);
+		f(pool.sizeBegin);
+		f(pool.sizeEnd);
+		f(pool.colour);
+		f(pool.colourBegin);
+		f(pool.colourEnd);
+		f(pool.speedLimitBegin);
+		f(pool.speedLimitEnd);
+		f(pool.speedLimit);
+	}
+};
+
+inline unsigned int ParticlePool::spawn()
+{
+	return m_numAlive++;
+}
+
+inline void ParticlePool::kill(unsigned int idx)
+{
+	--m_numAlive;
+	if (idx != m_numAlive)
+	{
+		copyParticle(idx, m_numAlive);
+	}
+}
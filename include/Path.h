@@ -5,6 +5,8 @@
 #pragma once
 #include <vector>
 #include <list>
+#include <algorithm> // for std::upper_bound
+#include <fstream>
 #include "AnimationMath.h"
 
 #include "custom_serialization.h"
@@ -61,6 +63,18 @@ namespace algomath
 	template<class T>
 	class Path;
 
+	// remembers where a lookup last landed on a path. things that move steadily along a path keep one,
+	// so each lookup only has to step forward from last time instead of searching the whole path
+	struct PathCursor
+	{
+		unsigned int entry; // index into every entry of every interval
+		unsigned int interval;
+
+		PathCursor() : entry(0), interval(0) {}
+	};
+
+#define PATH_CURSOR_MAX_STEPS 8 // a cursor further behind than this falls back to a binary search
+
 	template<class T>
 	Path<T> createDefaultTable();
 
@@ -82,83 +96,135 @@ namespace algomath
 	};
 
 	template <typename T>
-	void ReadPathDataFromFile(std::vector<std::list<NodeGraphTableEntry<T>>>& pathData, std::ifstream& file) {
+	void ReadPathDataFromFile(Path<T>& path, std::ifstream& file) {
 		int numLists = 0;
 		file.read((char*)&numLists, sizeof(int));
 
+		path.clear();
+		std::vector<NodeGraphTableEntry<T>> interval;
+
 		for (int ix = 0; ix < numLists; ix++) {	
 			int numEntries = 0;
 			file.read((char*)&numEntries, sizeof(int));
 
-			if (numEntries != 0) {
-				std::list<NodeGraphTableEntry<T>> list = std::list<NodeGraphTableEntry<T>>();
-
-				for (int jx = 0; jx < numEntries; jx++) {
-					NodeGraphTableEntry<T> instance = NodeGraphTableEntry<T>();
-					file.read(reinterpret_cast<char*>(&instance), sizeof(NodeGraphTableEntry<T>));
-					list.push_back(instance);
-				}
+			// a count the rest of the file can't hold means the file is damaged, fail the stream rather than allocate for it
+			std::streampos here = file.tellg();
+			file.seekg(0, std::ios::end);
+			std::streamoff left = file.tellg() - here;
+			file.seekg(here);
+			if (!file || numEntries < 0 || numEntries > left / (std::streamoff)sizeof(NodeGraphTableEntry<T>)) {
+				file.setstate(std::ios::failbit);
+				return;
+			}
 
-				pathData.push_back(list);
+			if (numEntries != 0) {
+				interval.resize(numEntries);
+				file.read(reinterpret_cast<char*>(interval.data()), sizeof(NodeGraphTableEntry<T>) * numEntries);
+				path.addInterval(interval.begin(), interval.end());
 			}
 		}
 	}
 
 	template <typename T>
-	void WritePathDataToFile(std::vector<std::list<NodeGraphTableEntry<T>>>& pathData, std::ofstream& file) {
-		int size = pathData.size();
+	void WritePathDataToFile(const Path<T>& path, std::ofstream& file) {
+		int size = path.numIntervals();
 		file.write((char*)&size, sizeof(int));
 
 		for (int ix = 0; ix < size; ix++) {
-			std::list<NodeGraphTableEntry<T>>& list = pathData[ix];
-
-			int listSize = list.size();
+			int listSize = path.intervalSize(ix);
 			file.write((char*)&listSize, sizeof(int));
 
 			if (listSize > 0) {
-				for (NodeGraphTableEntry<T>& element : list) {
-					file.write(reinterpret_cast<char*>(&element), sizeof(NodeGraphTableEntry<T>));
-				}
+				file.write(reinterpret_cast<const char*>(path.intervalBegin(ix)), sizeof(NodeGraphTableEntry<T>) * listSize);
 			}
 		}
 	}
 
-	//A table that defines a path, approximated into straight lines
+	//A table that defines a path, approximated into straight lines.
+	//every entry of every interval is stored back to back in one array, with an offset table marking where each interval starts.
+	//distances along the path are mirrored in their own array so lookups can binary search them without touching the values
 	template<class T>
 	class Path
 	{
 	public:
+		typedef NodeGraphTableEntry<T> Entry;
+		typedef Entry* iterator; // entries of an interval are contiguous, so plain pointers work as iterators
+		typedef const Entry* const_iterator;
+
 		Path();
 
-		std::vector<std::list<NodeGraphTableEntry<T>>> m_data; // vector of lists. each list is a table of data for one interval on the path
+		void clear();
+		template<class Iter>
+		void addInterval(Iter first, Iter last); // appends a table of entries as a new interval. call updateDistances afterwards if they have no distances yet
 
 		float getLength() const; // returns a float for length along the path. NOT table size
 		size_t numIntervals() const; // returns number of intervals i.e. nodes
+		size_t numEntries() const; // entries across every interval
+		size_t intervalSize(size_t interval) const;
 		void updateDistances(); //call this once if you modify the table data (NodeGrapher does this automatically)
 
-								//linear search functions
-		unsigned int lookupInterval(const float& distance);
+		iterator intervalBegin(size_t interval) { return m_entries.data() + m_offsets[interval]; }
+		iterator intervalEnd(size_t interval) { return m_entries.data() + m_offsets[interval + 1]; }
+		const_iterator intervalBegin(size_t interval) const { return m_entries.data() + m_offsets[interval]; }
+		const_iterator intervalEnd(size_t interval) const { return m_entries.data() + m_offsets[interval + 1]; }
+
+		const Entry& getEntry(size_t index) const { return m_entries[index]; } // index into every entry of every interval
+		unsigned int intervalOfEntry(size_t index) const; // which interval an entry index belongs to
 
-		typename std::list<NodeGraphTableEntry<T>>::iterator iterByDist(int vectorIndex, float dist); //returns the iterator at vectorIndex with the highest distanceAlongPath value that is less than argument distanceAlongPath																		//todo: optimize iterByValue to take in or hold the last iterator so it doesnt have to restart the search every time
+								//binary search functions, O(log n)
+		unsigned int lookupInterval(const float& distance) const;
+		size_t lookupEntry(const float& distance) const; // index of the last entry at or before distance, 0 if distance is before the start
 
-																									  //template <typename T>
-		typename std::list<NodeGraphTableEntry<T>>::iterator iterByTValue(int vectorIndex, float tVal); //returns the iterator at vectorIndex with the highest t value that is less than argument tVal
+		iterator iterByDist(int vectorIndex, float dist); //returns the iterator at vectorIndex with the highest distanceAlongPath value that is less than argument distanceAlongPath
+		iterator iterByTValue(int vectorIndex, float tVal); //returns the iterator at vectorIndex with the highest t value that is less than argument tVal
 
-		T lookupValue(const float& distance); // searches based off of distance along whole path
+		T lookupValue(const float& distance) const; // searches based off of distance along whole path
+		T lookupValue(const float& distance, PathCursor& cursor) const; // same result, starting the search from cursor
+
+		void advanceCursor(PathCursor& cursor, const float& distance) const; // moves cursor to lookupEntry(distance) and its interval
+		const_iterator cursorEntry(const PathCursor& cursor) const { return m_entries.data() + cursor.entry; }
 		T lookupPointIndexAndDistValue(int a_index, float a_distAlongPath);
 		T lookupPointIndexAndTValue(int a_index, float a_tLocal);
 
 		void Write(std::ofstream& file);
 		void Read(std::ifstream& file);
 	private:
+		T valueAt(size_t entry, unsigned int interval, const float& distance) const;
+
+		std::vector<Entry> m_entries; // every interval's table, back to back
+		std::vector<unsigned int> m_offsets; // interval i is entries [m_offsets[i], m_offsets[i + 1])
+		std::vector<float> m_distances; // distanceAlongPath of every entry, kept in step with m_entries
+
 		float m_length; // length of the path defined by this data
 	};
 
 	template<class T>
-	inline Path<T>::Path()
+	inline Path<T>::Path() : m_offsets(1, 0u), m_length(0.0f)
 	{
 	}
 
+	template<class T>
+	inline void Path<T>::clear()
+	{
+		m_entries.clear();
+		m_offsets.assign(1, 0u);
+		m_distances.clear();
+		m_length = 0.0f;
+	}
+
+	template<class T>
+	template<class Iter>
+	inline void Path<T>::addInterval(Iter first, Iter last)
+	{
+		for (; first != last; ++first)
+		{
+			m_entries.push_back(*first);
+			m_distances.push_back(first->distanceAlongPath);
+		}
+		m_offsets.push_back((unsigned int)m_entries.size());
+		m_length = m_distances.empty() ? 0.0f : m_distances.back();
+	}
+
 	template<class T>
 	inline float Path<T>::getLength() const
 	{
@@ -168,7 +234,19 @@ namespace algomath
 	template<class T>
 	inline size_t Path<T>::numIntervals() const
 	{
-		return m_data.size();
+		return m_offsets.size() - 1;
+	}
+
+	template<class T>
+	inline size_t Path<T>::numEntries() const
+	{
+		return m_entries.size();
+	}
+
+	template<class T>
+	inline size_t Path<T>::intervalSize(size_t interval) const
+	{
+		return m_offsets[interval + 1] - m_offsets[interval];
 	}
 
 	template<class T>
@@ -176,99 +254,150 @@ namespace algomath
 	{
 		double totalDistance = 0.0;
 		// will get constantly updated. represents total distance along whole curve
-		for (int interval = 0; interval < m_data.size(); interval++) // interval (the current keyNode)
+		for (size_t interval = 0; interval < numIntervals(); interval++) // interval (the current keyNode)
 		{
 			// compute pairwise distances and distance along path for all points in the table
-			std::list<NodeGraphTableEntry<T>>& table = m_data[interval];
-			table.front().distanceAlongPath = totalDistance;
-			std::list<NodeGraphTableEntry<T>>::iterator row = table.begin();
+			unsigned int row = m_offsets[interval];
+			unsigned int end = m_offsets[interval + 1];
+			if (row == end)
+			{
+				continue;
+			}
+
+			m_entries[row].distanceAlongPath = (float)totalDistance;
 
-			while (std::next(row) != table.end())
+			for (++row; row < end; ++row)
 			{
-				T lastRow = row->val;
-				++row;
-				T currentRow = row->val;
-				float pairwiseDist = glm::length(currentRow - lastRow);
+				float pairwiseDist = glm::length(m_entries[row].val - m_entries[row - 1].val);
 				totalDistance += pairwiseDist;
-				row->distanceAlongPath = totalDistance;
+				m_entries[row].distanceAlongPath = (float)totalDistance;
 			}
 		}
 		m_length = (float)totalDistance;
+
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			m_distances[i] = m_entries[i].distanceAlongPath;
+		}
 	}
 
 	template<class T>
-	inline unsigned int Path<T>::lookupInterval(const float & distance)
+	inline unsigned int Path<T>::intervalOfEntry(size_t index) const
 	{
-		unsigned int interval = m_data.size() - 1;
-		for (; m_data[interval].begin()->distanceAlongPath > distance; interval--)
-		{
-			//haha bad
-		}
-		return interval;
+		// the last interval whose first entry is at or before index
+		return (unsigned int)(std::upper_bound(m_offsets.begin(), m_offsets.end() - 1, (unsigned int)index) - m_offsets.begin()) - 1;
 	}
 
 	template<class T>
-	inline typename std::list<NodeGraphTableEntry<T>>::iterator Path<T>::iterByTValue(int vectorIndex, float tVal)
+	inline size_t Path<T>::lookupEntry(const float & distance) const
 	{
-		std::list<NodeGraphTableEntry<T>> &row = m_data[vectorIndex];
-		for (auto rit = ++row.rbegin(); rit != row.rend(); rit++) // reverse iteration. rBegin() points to the same element as --end()
+		size_t index = std::upper_bound(m_distances.begin(), m_distances.end(), distance) - m_distances.begin();
+		return (index > 0) ? index - 1 : 0;
+	}
+
+	template<class T>
+	inline unsigned int Path<T>::lookupInterval(const float & distance) const
+	{
+		// the interval holding the last entry at or before distance is the last interval starting at or before distance
+		return intervalOfEntry(lookupEntry(distance));
+	}
+
+	template<class T>
+	inline typename Path<T>::iterator Path<T>::iterByTValue(int vectorIndex, float tVal)
+	{
+		// t only rises within an interval. the last entry is never returned, so there is always an entry after the result
+		iterator first = intervalBegin(vectorIndex);
+		iterator last = intervalEnd(vectorIndex);
+		if (last - first < 2)
 		{
-			if (rit->t <= tVal)
-			{
-				//when converting from reverse iterator to forward iterator, we must first add 1 to make sure we are still pointing at the same thing
-				return (++rit).base();
-			}
+			return last; // couldnt find it, i.e. somethings messed up.
 		}
-		//throw std::exception("could not find in interval!");
-		return row.end(); // couldnt find it, i.e. somethings messed up.
+
+		iterator found = std::upper_bound(first, last - 1, tVal, [](float value, const Entry& entry) { return value < entry.t; });
+		return (found == first) ? last : found - 1;
 	}
 
 	template<class T>
-	inline typename std::list<NodeGraphTableEntry<T>>::iterator Path<T>::iterByDist(int vectorIndex, float dist)
+	inline typename Path<T>::iterator Path<T>::iterByDist(int vectorIndex, float dist)
 	{
-		std::list<NodeGraphTableEntry<T>> &row = m_data[vectorIndex];
-		for (auto rit = row.rbegin(); rit != row.rend(); rit++) // reverse iteration. rBegin() points to the same element as --end(). ++ causes rit to go backwards in the list
+		const float* first = m_distances.data() + m_offsets[vectorIndex];
+		const float* last = m_distances.data() + m_offsets[vectorIndex + 1];
+		const float* found = std::upper_bound(first, last, dist);
+
+		if (found == first)
 		{
-			if (rit->distanceAlongPath <= dist)
-			{
-				//when converting from reverse iterator to forward iterator, we must first add 1 to make sure we are still pointing at the same thing
-				return (++rit).base();
-			}
+			//throw std::exception("could not find in interval!!"); //ok you broke it for real now if you got here
+			return intervalEnd(vectorIndex);
 		}
-		//throw std::exception("could not find in interval!!"); //ok you broke it for real now if you got here
-		return row.end();
+		return m_entries.data() + (found - m_distances.data()) - 1;
 	}
 
 	template<class T>
-	inline T Path<T>::lookupValue(const float & distance)
+	inline T Path<T>::lookupValue(const float & distance) const
 	{
-		std::list<NodeGraphTableEntry<T>>::iterator iter;
+		size_t current = lookupEntry(distance);
+		return valueAt(current, intervalOfEntry(current), distance);
+	}
+
+	template<class T>
+	inline T Path<T>::lookupValue(const float & distance, PathCursor & cursor) const
+	{
+		advanceCursor(cursor, distance);
+		return valueAt(cursor.entry, cursor.interval, distance);
+	}
+
+	template<class T>
+	inline void Path<T>::advanceCursor(PathCursor & cursor, const float & distance) const
+	{
+		size_t numDistances = m_distances.size();
+
+		if (cursor.entry >= numDistances || m_distances[cursor.entry] > distance)
+		{
+			// moved backwards, wrapped around the path or the path changed
+			cursor.entry = (unsigned int)lookupEntry(distance);
+		}
+		else
+		{
+			for (unsigned int steps = 0; cursor.entry + 1 < numDistances && m_distances[cursor.entry + 1] <= distance; ++steps)
+			{
+				if (steps == PATH_CURSOR_MAX_STEPS)
+				{
+					cursor.entry = (unsigned int)(std::upper_bound(m_distances.begin() + cursor.entry, m_distances.end(), distance) - m_distances.begin()) - 1;
+					break;
+				}
+				++cursor.entry;
+			}
+		}
 
-		int interval = m_data.size() - 1;
-		for (; m_data[interval].begin()->distanceAlongPath > distance; interval--)
+		if (cursor.interval >= numIntervals() || m_offsets[cursor.interval] > cursor.entry)
+		{
+			cursor.interval = intervalOfEntry(cursor.entry);
+		}
+		else if (m_offsets[cursor.interval + 1] <= cursor.entry)
 		{
-			//exits loop when correct interval is found
-			//will attempt array access of -1 if nothing is found and thus exit 
-			//is this bad programming?
-#ifdef _DEBUG
-			if (interval < 0)
+			++cursor.interval;
+			if (m_offsets[cursor.interval + 1] <= cursor.entry)
 			{
-				throw std::exception("lookup could not find interval!");
+				cursor.interval = intervalOfEntry(cursor.entry);
 			}
-#endif // _DEBUG
 		}
+	}
+
+	template<class T>
+	inline T Path<T>::valueAt(size_t current, unsigned int interval, const float & distance) const
+	{
 		T ret;
-		iter = iterByDist(interval, distance);
-		std::list<NodeGraphTableEntry<T>>::iterator iter_next = std::next(iter);
-		if (iter_next == m_data[interval].end())
+		if (current + 1 == m_offsets[interval + 1])
 		{
-			iter_next = m_data[(interval + 1) % numIntervals()].begin();
-			ret = iter_next->val;
+			// past the end of this interval, the value is the start of the next one. wraps around at the end of the path
+			ret = m_entries[m_offsets[(interval + 1) % numIntervals()]].val;
 		}
 		else
 		{
-			float tValue = (distance - iter->distanceAlongPath) / (iter_next->distanceAlongPath - iter->distanceAlongPath);
-			ret = lerp(iter->val, iter_next->val, tValue);
+			const Entry& entry = m_entries[current];
+			const Entry& next = m_entries[current + 1];
+			float tValue = (distance - entry.distanceAlongPath) / (next.distanceAlongPath - entry.distanceAlongPath);
+			ret = lerp(entry.val, next.val, tValue);
 		}
 		return ret;
 	}
@@ -276,20 +405,8 @@ namespace algomath
 	template<class T>
 	inline T Path<T>::lookupPointIndexAndDistValue(int a_index, float a_distAlongPath)
 	{
-		std::list<NodeGraphTableEntry<T>>::iterator iter;
-		std::list<NodeGraphTableEntry<T>>::iterator iter_next;
-#ifdef NDEBUG 
-		try
-		{
-#endif // NDEBUG
-			iter = iterByDist(a_index, a_distAlongPath);
-			iter_next = std::next(iter);
-#ifdef NDEBUG
-		}
-		catch (std::exception e)
-		{
-		}
-#endif // NDEBUG
+		iterator iter = iterByDist(a_index, a_distAlongPath);
+		iterator iter_next = std::next(iter);
 
 		T ret;
 		float tValue = algomath::invLerp(a_distAlongPath, iter->distanceAlongPath, iter_next->distanceAlongPath); // (a_distAlongPath - iter->distanceAlongPath) / (iter_next->distanceAlongPath - iter->distanceAlongPath);
@@ -301,20 +418,9 @@ namespace algomath
 	template<class T>
 	inline T Path<T>::lookupPointIndexAndTValue(int a_index, float a_tLocal)
 	{
-		std::list<NodeGraphTableEntry<T>>::iterator iter;
-		std::list<NodeGraphTableEntry<T>>::iterator iter_next;
-#ifdef NDEBUG 
-		try
-		{
-#endif // NDEBUG
-			iter = iterByTValue(a_index, a_tLocal);
-			iter_next = std::next(iter);
-#ifdef NDEBUG
-		}
-		catch (std::exception e)
-		{
-		}
-#endif // NDEBUG
+		iterator iter = iterByTValue(a_index, a_tLocal);
+		iterator iter_next = std::next(iter);
+
 		T ret;
 		//create interpolation value from ratio between 3 tValues
 		float tEvenMoreLocal = algomath::invLerp(a_tLocal, iter->t, iter_next->t); //(a_tLocal - iter->t, ) / (iter_next->t - iter->t);
@@ -325,13 +431,13 @@ namespace algomath
 
 	template<class T>
 	inline void Path<T>::Write(std::ofstream & file) {
-		WritePathDataToFile(m_data, file);
+		WritePathDataToFile(*this, file);
 		file.write((char*)&m_length, sizeof(float));
 	}
 
 	template<class T>
 	inline void Path<T>::Read(std::ifstream & file) {
-		ReadPathDataFromFile(m_data, file);
+		ReadPathDataFromFile(*this, file);
 		file.read((char*)&m_length, sizeof(float));
 		updateDistances();
 	}
@@ -340,12 +446,11 @@ namespace algomath
 	inline Path<float> createDefaultTable() // a straight line from 0 to 1 of slope 1. if you interpolate along this spline, you will get a lerp.
 	{
 		Path<float> ret = Path<float>();
-		std::list<NodeGraphTableEntry<float>> intervalData = std::list<NodeGraphTableEntry<float>>();
-		NodeGraphTableEntry<float> entry = NodeGraphTableEntry<float>(0.0f, 0.0f, 0.0f);
-		intervalData.push_back(entry);
-		entry = NodeGraphTableEntry<float>(1.0f, 1.0f, 1.0f);
-		intervalData.push_back(entry);
-		ret.m_data.push_back(intervalData);
+		NodeGraphTableEntry<float> intervalData[2] = {
+			NodeGraphTableEntry<float>(0.0f, 0.0f, 0.0f),
+			NodeGraphTableEntry<float>(1.0f, 1.0f, 1.0f)
+		};
+		ret.addInterval(intervalData, intervalData + 2);
 		ret.updateDistances();
 		return ret;
 	}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+namespace algomath
+{
+	// Philox4x32-10 counter based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+	// there is no hidden state: the output is a pure function of (key, counter), so any number in a stream can be
+	// produced directly, from any thread, in any order, and replayed later from the same seed
+	inline void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+	{
+		uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+		uint32_t k0 = key[0], k1 = key[1];
+
+		for (int round = 0; round < 10; ++round)
+		{
+			uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+			uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+
+			uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+			uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+			c1 = (uint32_t)p1;
+			c3 = (uint32_t)p0;
+			c0 = n0;
+			c2 = n2;
+
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
+
+	// top 24 bits as a float in [0, 1)
+	inline float uintToUniform(uint32_t x)
+	{
+		return (float)(x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// a seeded family of independent random streams. stream n is the sequence of uniforms owned by e.g. the nth particle spawned
+	class CounterRandom
+	{
+	public:
+		CounterRandom(uint32_t seed = 0) : m_seed(seed) {}
+
+		void setSeed(uint32_t seed) { m_seed = seed; }
+		uint32_t getSeed() const { return m_seed; }
+
+		// count uniforms in [0, 1) from the start of one stream
+		void fillUniform(uint64_t stream, float* out, unsigned int count) const;
+
+		// perStream uniforms from each of numStreams consecutive streams, packed one stream after another.
+		// gives exactly the same numbers as calling fillUniform once per stream
+		void fillUniformBatch(uint64_t firstStream, unsigned int numStreams, unsigned int perStream, float* out) const;
+
+	private:
+		uint32_t m_seed;
+	};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#define SIMULATION_DEFAULT_STEP (1.0f / 60.0f)
+#define SIMULATION_DEFAULT_MAX_SUBSTEPS 4
+
+// turns variable frame times into a whole number of fixed simulation steps.
+// leftover time carries over to the next frame, and the fraction of a step it represents is used to
+// interpolate what gets drawn between the last two simulated states
+class SimulationClock
+{
+public:
+	SimulationClock(float fixedStep = SIMULATION_DEFAULT_STEP, unsigned int maxSubsteps = SIMULATION_DEFAULT_MAX_SUBSTEPS);
+
+	// adds a frame's worth of time and returns how many fixed steps to simulate. never more than maxSubsteps,
+	// time that would need more is dropped so a hitch slows the effect down instead of snowballing
+	unsigned int advance(float frameTime);
+
+	void reset(); // forget any accumulated time
+
+	float getFixedStep() const { return m_fixedStep; }
+	void setFixedStep(float fixedStep);
+
+	unsigned int getMaxSubsteps() const { return m_maxSubsteps; }
+	void setMaxSubsteps(unsigned int maxSubsteps) { m_maxSubsteps = maxSubsteps; }
+
+	float getInterpolation() const { return m_accumulator / m_fixedStep; } // [0, 1), how far between the last two steps the frame is
+	float getSimulatedTime() const { return m_simulatedTime; }
+	float getDroppedTime() const { return m_droppedTime; } // total time thrown away by the substep cap
+
+private:
+	float m_fixedStep;
+	unsigned int m_maxSubsteps;
+	float m_accumulator;
+	float m_simulatedTime;
+	float m_droppedTime;
+};
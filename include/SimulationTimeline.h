@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#define SIMULATION_TIMELINE_DEFAULT_INTERVAL 30 // steps between checkpoints, half a second at the default step
+#define SIMULATION_TIMELINE_DEFAULT_BUDGET (32u << 20) // bytes of compressed checkpoints kept
+
+// a bounded ring of simulation checkpoints, so an effect can be scrubbed or rewound without replaying it from the start.
+// a checkpoint is an opaque block of state saved every interval steps. each one is stored as the XOR against the one
+// before it, run length encoded, so bytes that didn't change between checkpoints cost next to nothing. the oldest is
+// stored against nothing, and when the budget is used up it is dropped and the next one takes its place
+class SimulationTimeline
+{
+public:
+	SimulationTimeline();
+
+	void clear();
+
+	bool isEnabled() const { return m_enabled; }
+	void setEnabled(bool enabled);
+
+	unsigned int getInterval() const { return m_interval; }
+	void setInterval(unsigned int steps); // clears the timeline if it changes
+
+	size_t getMemoryBudget() const { return m_budget; }
+	void setMemoryBudget(size_t bytes); // drops the oldest checkpoints until they fit
+
+	bool wantsCheckpoint(uint64_t step) const; // whether step should be recorded, the first step always is
+
+	// stores state as the checkpoint for step. any checkpoints at or after step belong to a future that is being
+	// simulated again, so they are dropped first
+	void record(uint64_t step, const std::vector<uint8_t>& state);
+
+	// decodes the newest checkpoint at or before step into state. returns false if every checkpoint is later than step
+	bool restore(uint64_t step, uint64_t& checkpointStep, std::vector<uint8_t>& state);
+
+	size_t numCheckpoints() const { return m_checkpoints.size(); }
+	uint64_t firstStep() const { return m_checkpoints.empty() ? 0 : m_checkpoints.front().step; }
+	uint64_t lastStep() const { return m_checkpoints.empty() ? 0 : m_checkpoints.back().step; }
+	size_t memoryUsed() const { return m_memoryUsed; } // compressed size of every checkpoint
+	size_t uncompressedSize() const { return m_uncompressedSize; } // what they would take stored whole
+
+private:
+	struct Checkpoint
+	{
+		uint64_t step;
+		size_t stateSize;
+		std::vector<uint8_t> delta; // XOR against the previous checkpoint's state, or against zeros for the oldest
+	};
+
+	static void encodeDelta(const std::vector<uint8_t>& base, const std::vector<uint8_t>& state, std::vector<uint8_t>& out);
+	static void applyDelta(const std::vector<uint8_t>& delta, size_t stateSize, std::vector<uint8_t>& state); // state goes from base to the checkpoint
+
+	void decode(size_t index, std::vector<uint8_t>& state) const; // walks the chain from the oldest checkpoint
+	void dropOldest();
+	void fitBudget();
+
+	bool m_enabled;
+	unsigned int m_interval;
+	size_t m_budget;
+	size_t m_memoryUsed;
+	size_t m_uncompressedSize;
+
+	std::deque<Checkpoint> m_checkpoints;
+
+	// decoded state of the newest checkpoint, what the next one is encoded against
+	std::vector<uint8_t> m_lastState;
+	bool m_lastStateValid;
+
+	std::vector<uint8_t> m_scratch;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#define SPATIAL_GRID_MIN_CELL_SIZE 0.001f
+#define SPATIAL_GRID_CELL_BIAS (1 << 20) // keeps cell coordinates positive, 21 bits per axis for the morton code
+
+namespace algomath
+{
+	// uniform grid of cubic cells hashed into a table about twice the size of the point count, so memory follows the
+	// number of points rather than the volume they cover. build counting sorts the points by cell and keeps copies of
+	// their positions and velocities in that order, so queries read contiguous memory and never see points that move
+	// while the grid is in use
+	class SpatialGrid
+	{
+	public:
+		// mortonOrder hashes cells by interleaving their coordinate bits instead of mixing them. nearby cells then land
+		// in nearby buckets, so points close in space are close in memory too
+		void build(const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz,
+			unsigned int count, float cellSize, bool mortonOrder);
+
+		void clear();
+
+		unsigned int numPoints() const { return (unsigned int)m_indices.size(); }
+		float getCellSize() const { return m_cellSize; }
+
+		// calls visit(index, position, velocity) for every point within radius of position, index being the point's
+		// index in the arrays build was given. stops early once visit returns false. radius can't be bigger than the
+		// cell size, so the search never spans more than 3x3x3 cells
+		template<typename Visitor>
+		void forEachNeighbour(const glm::vec3& position, float radius, Visitor&& visit) const
+		{
+			if (m_indices.empty())
+			{
+				return;
+			}
+
+			if (radius > m_cellSize)
+			{
+				radius = m_cellSize;
+			}
+
+			int lo[3], hi[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				lo[a] = cellCoord(position[a] - radius);
+				hi[a] = cellCoord(position[a] + radius);
+			}
+
+			// different cells can share a bucket, so remember which buckets were already searched
+			unsigned int searched[27];
+			unsigned int numSearched = 0;
+			float radius2 = radius * radius;
+
+			for (int cz = lo[2]; cz <= hi[2]; ++cz)
+			{
+				for (int cy = lo[1]; cy <= hi[1]; ++cy)
+				{
+					for (int cx = lo[0]; cx <= hi[0]; ++cx)
+					{
+						unsigned int bucket = bucketOf(cx, cy, cz);
+						unsigned int first = m_bucketStart[bucket];
+						unsigned int last = m_bucketStart[bucket + 1];
+						if (first == last)
+						{
+							continue;
+						}
+
+						unsigned int s = 0;
+						while (s < numSearched && searched[s] != bucket)
+						{
+							++s;
+						}
+						if (s < numSearched)
+						{
+							continue;
+						}
+						searched[numSearched++] = bucket;
+
+						for (unsigned int i = first; i < last; ++i)
+						{
+							glm::vec3 other(m_x[i], m_y[i], m_z[i]);
+							glm::vec3 offset = other - position;
+							if (glm::dot(offset, offset) > radius2)
+							{
+								continue;
+							}
+
+							if (!visit(m_indices[i], other, glm::vec3(m_vx[i], m_vy[i], m_vz[i])))
+							{
+								return;
+							}
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		inline int cellCoord(float v) const
+		{
+			return (int)std::floor(v * m_inverseCellSize);
+		}
+
+		inline unsigned int bucketOf(int cx, int cy, int cz) const
+		{
+			uint64_t key;
+			if (m_mortonOrder)
+			{
+				key = spreadBits((uint32_t)(cx + SPATIAL_GRID_CELL_BIAS))
+					| (spreadBits((uint32_t)(cy + SPATIAL_GRID_CELL_BIAS)) << 1)
+					| (spreadBits((uint32_t)(cz + SPATIAL_GRID_CELL_BIAS)) << 2);
+			}
+			else
+			{
+				// the usual large prime hash (Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable Objects")
+				key = ((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u) ^ ((uint32_t)cz * 83492791u);
+			}
+			return (unsigned int)(key & m_bucketMask);
+		}
+
+		// moves the low 21 bits of v three bits apart, for interleaving
+		static inline uint64_t spreadBits(uint32_t v)
+		{
+			uint64_t x = v & 0x1FFFFF;
+			x = (x | (x << 32)) & 0x1F00000000FFFFull;
+			x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+			x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+			x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+			x = (x | (x << 2)) & 0x1249249249249249ull;
+			return x;
+		}
+
+		float m_cellSize = 1.0f;
+		float m_inverseCellSize = 1.0f;
+		bool m_mortonOrder = false;
+		uint64_t m_bucketMask = 0;
+
+		std::vector<unsigned int> m_bucketStart; // points of bucket b are [m_bucketStart[b], m_bucketStart[b + 1])
+		std::vector<unsigned int> m_pointBucket; // bucket of every point in build order, kept to avoid reallocating
+		std::vector<unsigned int> m_indices; // original index of every sorted point
+		std::vector<float> m_x, m_y, m_z;
+		std::vector<float> m_vx, m_vy, m_vz;
+	};
+}
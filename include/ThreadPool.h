@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+
+// a fixed set of worker threads that live for the whole program, so handing out work costs a wake up rather than a thread launch.
+// <thread> and <mutex> can't be included when compiling with /clr, so everything threading related is hidden in ThreadPool.cpp
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int numWorkers = 0); // 0 picks one worker per hardware thread, minus the calling thread
+	~ThreadPool();
+
+	static ThreadPool& global(); // shared pool, created on first use
+
+	unsigned int numWorkers() const;
+
+	// calls task(i) for every i in [0, count) and returns once they have all finished.
+	// the calling thread works on the loop too. a parallelFor started from inside another one, on any thread, runs serially there
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& task);
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	struct Impl;
+	Impl* m_impl;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define VECTOR_FIELD_MAGIC 0x444C4656u // "VFLD"
+#define VECTOR_FIELD_FILE_VERSION 1
+#define VECTOR_FIELD_MIN_SIZE 2 // trilinear sampling needs two samples per axis
+#define VECTOR_FIELD_MAX_CELLS (1u << 31) // every cell index fits the 32 bit offsets of the avx2 gathers
+
+namespace algomath
+{
+	enum VECTOR_FIELD_MODE
+	{
+		VECTOR_FIELD_FORCE = 0, // the field's vectors are added to the particle's force
+		VECTOR_FIELD_VELOCITY, // the field's vectors are velocities, particles are pushed toward them
+		NUM_VECTOR_FIELD_MODES
+	};
+
+	// header of a .vfld file. sizeX * sizeY * sizeZ floats of x components follow, then the y components, then z.
+	// x varies fastest. keeping the components apart means a mapped file is already in the layout the kernels read
+	struct VectorFieldHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sizeX;
+		uint32_t sizeY;
+		uint32_t sizeZ;
+		uint32_t reserved;
+	};
+
+	// a 3D grid of vectors covering the unit cube [-0.5, 0.5]^3. either generated in memory or memory-mapped
+	// from a .vfld file, so large imported fields cost no load time and no copies
+	class VectorField
+	{
+	public:
+		VectorField();
+		~VectorField();
+
+		VectorField(const VectorField&) = delete;
+		VectorField& operator=(const VectorField&) = delete;
+
+		// divergence free swirls: the curl of three noise potentials. frequency is noise cells across the field
+		void generateCurlNoise(unsigned int size, float frequency, unsigned int seed);
+
+		bool loadFromFile(const std::string& path); // maps the file, returns false and leaves the field empty if it is not a valid .vfld
+		bool saveToFile(const std::string& path) const;
+
+		void unload();
+
+		bool isLoaded() const { return m_x != nullptr; }
+		unsigned int sizeX() const { return m_size[0]; }
+		unsigned int sizeY() const { return m_size[1]; }
+		unsigned int sizeZ() const { return m_size[2]; }
+
+		// component arrays, sizeX * sizeY * sizeZ floats each
+		const float* dataX() const { return m_x; }
+		const float* dataY() const { return m_y; }
+		const float* dataZ() const { return m_z; }
+
+	private:
+		bool setSize(unsigned int sizeX, unsigned int sizeY, unsigned int sizeZ);
+
+		unsigned int m_size[3];
+		const float* m_x;
+		const float* m_y;
+		const float* m_z;
+
+		std::vector<float> m_generated; // owns the data of a generated field
+
+		// the mapped view of a loaded file. the file itself is closed once mapped, the view keeps it alive
+		const void* m_view;
+		size_t m_viewSize;
+	};
+}
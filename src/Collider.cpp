@@ -0,0 +1,49 @@
+#include "Collider.h"
+
+#include <GLM\gtc\quaternion.hpp> // for glm::mat3_cast
+
+namespace algomath
+{
+	/*
+	 * @description works out the collider's axes so the kernels never deal with euler angles
+	 * @method prepareCollider
+	 * @params {const Collider&} collider
+	 * @return {ColliderShape}
+	 */
+	ColliderShape prepareCollider(const Collider& collider)
+	{
+		// same euler convention as Transform::setRotation, but in degrees
+		glm::mat3 rotation = glm::mat3_cast(glm::quat(glm::radians(collider.rotation)));
+
+		ColliderShape shape;
+		shape.shape = collider.shape;
+		shape.response = collider.response;
+		shape.centre = collider.position;
+		for (int a = 0; a < 3; ++a)
+		{
+			shape.axes[a] = rotation[a];
+		}
+		shape.halfExtents = glm::max(collider.halfExtents, glm::vec3(0.0f));
+		shape.radius = (collider.radius > 0.0f) ? collider.radius : 0.0f;
+		shape.halfLength = (collider.halfLength > 0.0f) ? collider.halfLength : 0.0f;
+		shape.bounce = collider.bounce;
+		shape.friction = glm::clamp(collider.friction, 0.0f, 1.0f);
+		return shape;
+	}
+
+	const char* colliderShapeName(int shape)
+	{
+		switch (shape)
+		{
+		case COLLIDER_SPHERE:
+			return "sphere";
+		case COLLIDER_BOX:
+			return "box";
+		case COLLIDER_CAPSULE:
+			return "capsule";
+		default:
+		case COLLIDER_PLANE:
+			return "plane";
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#include "LookupTable.h"
+
+#include <cmath>
+
+namespace algomath
+{
+	LookupTable::LookupTable()
+	{
+		for (unsigned int i = 0; i <= LOOKUP_TABLE_RESOLUTION; ++i)
+		{
+			m_samples[i] = (float)i / LOOKUP_TABLE_RESOLUTION;
+		}
+	}
+
+	/*
+	 * @description samples the graph at every table entry
+	 * @method bake
+	 * @params {Path<float>&} graph
+	 * @return {void}
+	 */
+	void LookupTable::bake(Path<float>& graph)
+	{
+		if (graph.numEntries() == 0)
+		{
+			for (unsigned int i = 0; i <= LOOKUP_TABLE_RESOLUTION; ++i)
+			{
+				m_samples[i] = 0.0f;
+			}
+			return;
+		}
+
+		// lookupValue wraps back to the first node when asked for the very end of the graph, so take the last node directly
+		const NodeGraphTableEntry<float>& last = graph.getEntry(graph.numEntries() - 1);
+
+		for (unsigned int i = 0; i <= LOOKUP_TABLE_RESOLUTION; ++i)
+		{
+			float t = (float)i / LOOKUP_TABLE_RESOLUTION;
+			m_samples[i] = (t >= last.distanceAlongPath) ? last.val : graph.lookupValue(t);
+		}
+	}
+
+	/*
+	 * @description measures how far lookup is from the graph it was baked from. the end of the graph is skipped, see bake
+	 * @method maxError
+	 * @params {Path<float>&} graph
+	 * @params {unsigned int} samplesPerCell
+	 * @return {float}
+	 */
+	float LookupTable::maxError(Path<float>& graph, unsigned int samplesPerCell) const
+	{
+		if (graph.numEntries() == 0)
+		{
+			return 0.0f;
+		}
+
+		float end = graph.getEntry(graph.numEntries() - 1).distanceAlongPath;
+		unsigned int numSamples = LOOKUP_TABLE_RESOLUTION * samplesPerCell;
+		float error = 0.0f;
+
+		for (unsigned int i = 0; i < numSamples; ++i)
+		{
+			float t = (float)i / numSamples;
+			if (t >= end)
+			{
+				break;
+			}
+
+			error = max(error, std::fabs(lookup(t) - graph.lookupValue(t)));
+		}
+
+		return error;
+	}
+}
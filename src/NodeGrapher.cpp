@@ -64,7 +64,7 @@ namespace algomath
 
 	void PathEditor::updateTable(float tolerance)
 	{
-		m_table.m_data.clear();
+		m_table.clear();
 
 		for (int i = 0; i < m_nodes.size() - 1; i++) // for each interval...
 		{
@@ -85,7 +85,7 @@ namespace algomath
 			recursiveSubdivide(beforefirstNode, firstNode, secondNode, afterSecondNode, subTable.begin(), --subTable.end(), subTable, tolerance); // takes subTable as a ref parameter to fill it with subdivisions
 
 			//insert subtable into master table
-			m_table.m_data.push_back(subTable);
+			m_table.addInterval(subTable.begin(), subTable.end());
 		}
 		//compute pairwise distances and lengths along the curve
 		m_table.updateDistances();
@@ -98,12 +98,10 @@ namespace algomath
 		// Draw Node lines
 		for (int i = 0; i < m_table.numIntervals(); i++)
 		{
-			auto row = &m_table.m_data[i];
-
-			auto it = row->begin();
+			auto it = m_table.intervalBegin(i);
 			auto it2 = std::next(it);
 
-			while (it2 != row->end())
+			while (it2 != m_table.intervalEnd(i))
 			{
 				//TTK::Graphics::DrawLine(it->val, it2->val, 5.5f, col);
 
@@ -305,13 +303,7 @@ namespace algomath
 
 			for (size_t i = 0; i < nodeGraphTableEntries.size(); i++)
 			{
-				std::list<NodeGraphTableEntry<float>> table;
-
-				for each (NodeGraphTableEntry<float> tableEntry in nodeGraphTableEntries[i])
-				{
-					table.push_back(tableEntry);
-				}
-				returnGraph.m_data.push_back(table);
+				returnGraph.addInterval(nodeGraphTableEntries[i].begin(), nodeGraphTableEntries[i].end());
 			}
 
 			graphFile.close();
@@ -345,12 +337,7 @@ namespace algomath
 
 			for (size_t i = 0; i < nodeGraphTableEntries.size(); i++)
 			{
-				std::list<NodeGraphTableEntry<glm::vec3>> table;
-				for each (NodeGraphTableEntry<glm::vec3> tableEntry in nodeGraphTableEntries[i])
-				{
-					table.push_back(tableEntry);
-				}
-				returnGraph.m_data.push_back(table);
+				returnGraph.addInterval(nodeGraphTableEntries[i].begin(), nodeGraphTableEntries[i].end());
 			}
 			returnGraph.updateDistances();
 
@@ -389,14 +376,9 @@ namespace algomath
 			boost::archive::text_oarchive oa(graphFile);
 			std::vector<std::vector<NodeGraphTableEntry<glm::vec3>>> nodeGraphTableEntries; // data to output
 
-			for (int i = 0; i < saveThis.m_data.size(); i++)
+			for (int i = 0; i < saveThis.numIntervals(); i++)
 			{
-				std::vector<NodeGraphTableEntry<glm::vec3>> table;
-				for (auto iter = saveThis.m_data[i].begin(); iter != saveThis.m_data[i].end(); iter++)
-				{
-					table.push_back(*iter);
-				}
-				nodeGraphTableEntries.push_back(table);
+				nodeGraphTableEntries.push_back(std::vector<NodeGraphTableEntry<glm::vec3>>(saveThis.intervalBegin(i), saveThis.intervalEnd(i)));
 			}
 
 			oa << nodeGraphTableEntries;
@@ -0,0 +1,107 @@
+#include "ParticleBudget.h"
+#include "ParticleEmitter.h"
+
+#include <algorithm> // for std::stable_sort
+
+/*
+ * @description the budget every ParticleSystem shares
+ * @method global
+ * @return {ParticleBudget&}
+ */
+ParticleBudget& ParticleBudget::global()
+{
+	static ParticleBudget budget;
+	return budget;
+}
+
+/*
+ * @description adds up what the frame cost, moves at most one throttle a step, shares out the particle cap and hands
+ * the result to every system for the next frame
+ * @method balance
+ * @params {const std::vector<ParticleSystem*>&} systems - every system that simulated this frame
+ * @params {float} frameTime - seconds the frame covered, for the throttled time reported
+ * @return {void}
+ */
+void ParticleBudget::balance(const std::vector<ParticleSystem*>& systems, float frameTime)
+{
+	m_frameMs = 0.0f;
+	m_particlesAlive = 0;
+	for (auto system : systems)
+	{
+		m_frameMs += system->budget.simulateMs;
+		m_particlesAlive += system->budget.particlesAlive;
+	}
+	m_averageMs += (m_frameMs - m_averageMs) * PARTICLE_BUDGET_SMOOTHING;
+
+	m_byPriority.assign(systems.begin(), systems.end());
+	std::stable_sort(m_byPriority.begin(), m_byPriority.end(), [](const ParticleSystem* a, const ParticleSystem* b)
+	{
+		return a->budget.priority > b->budget.priority;
+	});
+
+	if (!enabled)
+	{
+		for (auto system : m_byPriority)
+		{
+			system->budget.throttle = 0.0f;
+			system->budget.particleQuota = ~0u;
+			system->applyBudget();
+		}
+		return;
+	}
+
+	if (++m_framesSinceChange >= PARTICLE_BUDGET_SETTLE_FRAMES)
+	{
+		ParticleSystem* chosen = nullptr;
+		if (m_averageMs > frameBudgetMs)
+		{
+			// the lowest priority that can still be throttled, and of those the most expensive
+			for (auto system : m_byPriority)
+			{
+				if (system->budget.throttle < 1.0f && (!chosen || system->budget.priority < chosen->budget.priority
+					|| (system->budget.priority == chosen->budget.priority && system->budget.averageMs > chosen->budget.averageMs)))
+				{
+					chosen = system;
+				}
+			}
+			if (chosen)
+			{
+				chosen->budget.throttle = std::min(chosen->budget.throttle + PARTICLE_BUDGET_THROTTLE_STEP, 1.0f);
+			}
+		}
+		else if (m_averageMs < frameBudgetMs * PARTICLE_BUDGET_RELAX)
+		{
+			// the highest priority that is throttled
+			for (auto system : m_byPriority)
+			{
+				if (system->budget.throttle > 0.0f)
+				{
+					chosen = system;
+					break;
+				}
+			}
+			if (chosen)
+			{
+				chosen->budget.throttle = std::max(chosen->budget.throttle - PARTICLE_BUDGET_THROTTLE_STEP, 0.0f);
+			}
+		}
+
+		if (chosen)
+		{
+			m_framesSinceChange = 0;
+		}
+	}
+
+	unsigned int remaining = maxParticles;
+	for (auto system : m_byPriority)
+	{
+		system->budget.particleQuota = std::min(system->budget.capacity, remaining);
+		remaining -= system->budget.particleQuota;
+
+		if (system->budget.throttle > 0.0f)
+		{
+			system->budget.throttledTime += frameTime;
+		}
+		system->applyBudget();
+	}
+}
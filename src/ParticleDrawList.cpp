@@ -0,0 +1,202 @@
+#include "ParticleDrawList.h"
+
+#include <algorithm> // for std::stable_sort
+#include <TTK\GraphicsUtils.h> // for drawing utilities
+
+/*
+ * @description pulls the planes out of the view's combined matrix (Gribb and Hartmann,
+ * "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix")
+ * @method ParticleFrustum
+ * @params {const ParticleRenderView&} view
+ */
+ParticleFrustum::ParticleFrustum(const ParticleRenderView& view)
+{
+	glm::mat4 m = glm::transpose(view.projectionMatrix * view.viewMatrix); // rows of the matrix as columns
+	planes[0] = m[3] + m[0];
+	planes[1] = m[3] - m[0];
+	planes[2] = m[3] + m[1];
+	planes[3] = m[3] - m[1];
+	planes[4] = m[3] + m[2];
+	planes[5] = m[3] - m[2];
+
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+/*
+ * @description whether any of a sphere is inside the frustum. conservative near the corners, like every plane test
+ * @method intersectsSphere
+ * @params {const glm::vec3&} centre
+ * @params {float} radius
+ * @return {bool}
+ */
+bool ParticleFrustum::intersectsSphere(const glm::vec3& centre, float radius) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * @description whether any of a box is inside the frustum. the box's extent is projected onto each plane's normal
+ * for the distance its nearest corner can be from its centre
+ * @method intersectsBox
+ * @params {const ParticleBounds&} box
+ * @return {bool}
+ */
+bool ParticleFrustum::intersectsBox(const ParticleBounds& box) const
+{
+	if (box.empty())
+	{
+		return false;
+	}
+
+	glm::vec3 centre = box.centre();
+	glm::vec3 extent = box.extent();
+	for (const glm::vec4& plane : planes)
+	{
+		glm::vec3 normal = glm::vec3(plane);
+		if (glm::dot(normal, centre) + plane.w < -glm::dot(glm::abs(normal), extent))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * @description grows the box to take in point
+ * @method add
+ * @params {const glm::vec3&} point
+ * @return {void}
+ */
+void ParticleBounds::add(const glm::vec3& point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+/*
+ * @description grows the box to take in another one
+ * @method add
+ * @params {const ParticleBounds&} other
+ * @return {void}
+ */
+void ParticleBounds::add(const ParticleBounds& other)
+{
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+/*
+ * @description moves every face out by distance
+ * @method expand
+ * @params {float} distance
+ * @return {void}
+ */
+void ParticleBounds::expand(float distance)
+{
+	if (!empty())
+	{
+		min -= glm::vec3(distance);
+		max += glm::vec3(distance);
+	}
+}
+
+/*
+ * @description the box around this one transformed by matrix (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+ * @method transformed
+ * @params {const glm::mat4&} matrix
+ * @return {ParticleBounds}
+ */
+ParticleBounds ParticleBounds::transformed(const glm::mat4& matrix) const
+{
+	if (empty())
+	{
+		return *this;
+	}
+
+	glm::vec3 centre = glm::vec3(matrix * glm::vec4(this->centre(), 1.0f));
+	glm::vec3 extent = glm::abs(glm::vec3(matrix[0])) * this->extent().x
+		+ glm::abs(glm::vec3(matrix[1])) * this->extent().y
+		+ glm::abs(glm::vec3(matrix[2])) * this->extent().z;
+
+	ParticleBounds result;
+	result.min = centre - extent;
+	result.max = centre + extent;
+	return result;
+}
+
+/*
+ * @description empties the list without freeing its memory
+ * @method clear
+ * @return {void}
+ */
+void ParticleDrawList::clear()
+{
+	m_instances.clear();
+	m_batches.clear();
+	m_numCulled = 0;
+}
+
+/*
+ * @description reserves count instances drawn with mesh
+ * @method append
+ * @params {TTK::OBJMesh *} mesh - mesh to draw the instances with, nullptr for a sphere
+ * @params {unsigned int} count
+ * @return {ParticleInstance *} the first of count instances for the caller to fill
+ */
+ParticleInstance* ParticleDrawList::append(TTK::OBJMesh* mesh, unsigned int count)
+{
+	unsigned int first = (unsigned int)m_instances.size();
+	m_instances.resize(first + count);
+
+	if (!m_batches.empty() && m_batches.back().mesh == mesh && m_batches.back().first + m_batches.back().count == first)
+	{
+		m_batches.back().count += count;
+	}
+	else
+	{
+		m_batches.push_back({ mesh, first, count });
+	}
+
+	return m_instances.data() + first;
+}
+
+/*
+ * @description draws every instance in the list. batches are sorted so each mesh is drawn in one go,
+ * keeping the order emitters were rendered in for batches of the same mesh
+ * @method submit
+ * @return {void}
+ */
+void ParticleDrawList::submit()
+{
+	std::stable_sort(m_batches.begin(), m_batches.end(), [](const ParticleBatch& a, const ParticleBatch& b)
+	{
+		return a.mesh < b.mesh;
+	});
+
+	for (const ParticleBatch& batch : m_batches)
+	{
+		for (unsigned int i = batch.first; i < batch.first + batch.count; ++i)
+		{
+			ParticleInstance& instance = m_instances[i];
+			if (batch.mesh == nullptr)
+			{
+				TTK::Graphics::DrawSphere(instance.matrix, 0.5f, instance.colour);
+			}
+			else
+			{
+				batch.mesh->setAllColours(instance.colour);
+				batch.mesh->draw(instance.matrix);
+			}
+		}
+	}
+}
@@ -3,8 +3,13 @@
 // Modified By: Shawn Matthews
 
 #include <map> // for std::map
+#include <algorithm> // for std::find
+#include <cstring> // for memcpy
+#include <cfloat> // for FLT_MAX
+#include <initializer_list>
+#include <utility> // for std::index_sequence
+#include <random> // for std::random_device
 #include <iostream> // for std::cout
-#include <glm\gtc\random.hpp> // for glm::linearRand
 #include <GLM\gtc\type_ptr.hpp>
 
 #include <GLM\gtc\matrix_transform.hpp> // for glm::transform
@@ -13,42 +18,28 @@
 
 #include "AnimationMath.h"
 #include "ParticleEmitter.h"
+#include "ParticleKernels.h"
+#include "ThreadPool.h"
 #include <GLM/gtx/norm.hpp>
 #include <glm/glm.hpp>
 #include <GLM/gtx/projection.hpp>
 #include <glm/gtx/polar_coordinates.hpp>
 #include <limits>
+#include <cmath> // for std::llround
 
-#define RANDOM glm::linearRand(0.0f, 1.0f)
 #define PI 3.14159f
 
-// Particle Class Methods 
+// Particle Behaviours
 /****************************************************************************************/
 
-/*
- * @description update method for the particle class
- * @method update
- * @return {void}
- */
-void Particle::update(float dt)
-{
-	acceleration += force / mass;
-	velocity += (acceleration * dt);
-
-	force *= 0.f;
-	acceleration *= 0.f;
-
-	transform.update();
-}
-
 /*
  * @description enables seeking behaviour for each particle
  * @method seek
  * @return {glm::vec3}
  */
-glm::vec3 Particle::seek(const glm::vec3 & target, const float & strength)
+glm::vec3 algomath::seek(const glm::vec3 & position, const glm::vec3 & target, const float & strength)
 {
-	glm::vec3 targetVector = target - transform.getPosition();
+	glm::vec3 targetVector = target - position;
 	float length = glm::length(targetVector);
 
 #ifdef _DEBUG
@@ -71,9 +62,9 @@ glm::vec3 Particle::seek(const glm::vec3 & target, const float & strength)
  * @method steer
  * @return {glm::vec3}
  */
-glm::vec3 Particle::steer(const glm::vec3 & target, const float & strength, const float& powerCap)
+glm::vec3 algomath::steer(const glm::vec3 & position, const glm::vec3 & velocity, const glm::vec3 & target, const float & strength, const float& powerCap)
 {
-	glm::vec3 targetVector = target - transform.getPosition();
+	glm::vec3 targetVector = target - position;
 	float length = glm::length(targetVector);
 
 	if (length > 0.0f)
@@ -95,9 +86,9 @@ glm::vec3 Particle::steer(const glm::vec3 & target, const float & strength, cons
  * @method arrive
  * @return {glm::vec3}
  */
-glm::vec3 Particle::arrive(const glm::vec3 & target, const float& strength, const float & radius, const float& powerCap)
+glm::vec3 algomath::arrive(const glm::vec3 & position, const glm::vec3 & velocity, const glm::vec3 & target, const float& strength, const float & radius, const float& powerCap)
 {
-	glm::vec3 targetVector = (target - transform.getPosition());
+	glm::vec3 targetVector = (target - position);
 
 	//faster than length() < radius
 	float length2 = glm::length2(targetVector);
@@ -131,9 +122,9 @@ glm::vec3 Particle::arrive(const glm::vec3 & target, const float& strength, cons
 * @method attract
 * @return {glm::vec3}
 */
-glm::vec3 Particle::attract(const glm::vec3 & target, const float & strength, const float & radius, const float & minRange)
+glm::vec3 algomath::attract(const glm::vec3 & position, const glm::vec3 & velocity, const glm::vec3 & target, const float & strength, const float & radius, const float & minRange)
 {
-	glm::vec3 targetVector = (target - transform.getPosition());
+	glm::vec3 targetVector = (target - position);
 	float length2 = glm::length2(targetVector);
 	float rad2 = radius * radius;
 
@@ -158,9 +149,9 @@ glm::vec3 Particle::attract(const glm::vec3 & target, const float & strength, co
 * @method gravitate
 * @return {glm::vec3}
 */
-glm::vec3 Particle::gravitate(const glm::vec3 & target, const float & strength, const float& powerCap, const float & minRange)
+glm::vec3 algomath::gravitate(const glm::vec3 & position, const glm::vec3 & target, const float & strength, const float& powerCap, const float & minRange)
 {
-	glm::vec3 targetVector = (target - transform.getPosition());
+	glm::vec3 targetVector = (target - position);
 	float length2 = glm::length2(targetVector);
 
 	glm::vec3 ret;
@@ -182,27 +173,6 @@ glm::vec3 Particle::gravitate(const glm::vec3 & target, const float & strength,
 
 
 
-/* 
- * @description draws each particle to the viewport
- * @method draw
- * @return {void}
- */
-void Particle::draw()
-{
-	//TTK::Graphics::DrawSphere(worldMatrix, 0.5f, colour);
-	
-	if(mesh == nullptr)
-	{
-		TTK::Graphics::DrawSphere(worldMatrix, 0.5f, colour);
-	}
-	else {
-		mesh->setAllColours(colour);
-		mesh->draw(worldMatrix);
-	}
-	
-
-}
-
 // ParticleEmitter Methods
 /**************************************************************************************/
 
@@ -233,83 +203,81 @@ void ParticleEmitter::loadMeshes()
 		myState.meshes["hexagon"]->colours.push_back(glm::vec4(1.0f));
 	}
 
-	Particle* particle = particles;
-	for (unsigned int i = 0; i < myConfig.numberOfParticles; ++i, ++particle)
-	{
-		particle->mesh = myState.meshes["hexagon"];
-	}
-
+	myState.particleMesh = myState.meshes["hexagon"];
 }
 
 /*
 * @description emits particles in cuboid shape
 * @method emitFromCuboid
+* @params {unsigned int} idx - index of the particle
+* @params {const float *} randoms - 3 uniforms in [0, 1)
 * @return {void}
 */
-void ParticleEmitter::emitFromCuboid(Particle* p)
+void ParticleEmitter::emitFromCuboid(unsigned int idx, const float* randoms)
 {
-	glm::vec3 pos;
-	pos.x = glm::linearRand(myConfig.boxSize.x / -2.0f, myConfig.boxSize.x / 2.0f);
-	pos.y = glm::linearRand(myConfig.boxSize.y / -2.0f, myConfig.boxSize.y / 2.0f);
-	pos.z = glm::linearRand(myConfig.boxSize.z / -2.0f, myConfig.boxSize.z / 2.0f);
+	glm::vec3 pos = (glm::vec3(randoms[0], randoms[1], randoms[2]) - 0.5f) * myConfig.boxSize;
 
-	p->transform.setPosition(pos);
+	particles.position.set(idx, pos);
 
-	p->velocity = glm::vec3(0.0f, 0.0f, 1.0f);
+	particles.velocity.set(idx, glm::vec3(0.0f, 0.0f, 1.0f));
 }
 
 /*
 * @description emits particles in spherical shape
 * @method emitFromSphere
+* @params {unsigned int} idx - index of the particle
+* @params {const float *} randoms - 3 uniforms in [0, 1)
 * @return {void}
 */
-void ParticleEmitter::emitFromSphere(Particle * p)
+void ParticleEmitter::emitFromSphere(unsigned int idx, const float* randoms)
 {
-	float longitude = acos((2.0f * RANDOM) - 1.0f);
-	float latitude = RANDOM * 2.0f * PI;
+	float longitude = acos((2.0f * randoms[0]) - 1.0f);
+	float latitude = randoms[1] * 2.0f * PI;
 
 	glm::vec2 polar = glm::vec2(latitude, longitude);
 
 	glm::vec3 direction = glm::euclidean(polar);
 
-	p->transform.setPosition(direction * glm::linearRand(0.0f, myConfig.sphereRadius));
+	particles.position.set(idx, direction * (randoms[2] * myConfig.sphereRadius));
 
 #ifdef _DEBUG
-	if (isnan(p->transform.getPosition().x))
+	if (isnan(particles.position.x[idx]))
 	{
 		printf("NaN spawn!\n");
 	}
 #endif //debug
 
-	p->velocity = direction;
+	particles.velocity.set(idx, direction);
 }
 
 /*
 * @description emits particles in cone-like shape (frustum)
 * @method emitFromFrustrum
+* @params {unsigned int} idx - index of the particle
+* @params {const float *} randoms - 5 uniforms in [0, 1)
 * @return {void}
 */
-void ParticleEmitter::emitFromFrustum(Particle * p)
+void ParticleEmitter::emitFromFrustum(unsigned int idx, const float* randoms)
 {
-	float normalizedRadiusSpawn = RANDOM;
-	float rotSpawn = glm::linearRand(0.0f, 2.0f * PI);
+	float normalizedRadiusSpawn = randoms[0];
+	float rotSpawn = randoms[1] * 2.0f * PI;
 
 	glm::vec3 posSpawn = glm::vec3(normalizedRadiusSpawn * myConfig.frustumRadiusSpawn * cos(rotSpawn), 0.f, normalizedRadiusSpawn * myConfig.frustumRadiusSpawn * sin(rotSpawn)); // y up
 	glm::vec3 posTarget = glm::vec3(normalizedRadiusSpawn * myConfig.frustumRadiusTarget * cos(rotSpawn), myConfig.frustumHeight, normalizedRadiusSpawn * myConfig.frustumRadiusTarget * sin(rotSpawn));
 
 	glm::vec3 delta = posTarget - posSpawn;
 
-	p->transform.setPosition(glm::linearRand(posSpawn, posTarget));
+	particles.position.set(idx, glm::mix(posSpawn, posTarget, glm::vec3(randoms[2], randoms[3], randoms[4])));
 
 	float deltaLen = glm::length(delta);
 
 	if (deltaLen == 0.0f)
 	{
-		p->velocity = glm::vec3(0.f, 0.f, 1.f);
+		particles.velocity.set(idx, glm::vec3(0.f, 0.f, 1.f));
 	}
 	else
 	{
-		p->velocity = delta / deltaLen;
+		particles.velocity.set(idx, delta / deltaLen);
 	}
 }
 
@@ -320,15 +288,10 @@ void ParticleEmitter::emitFromFrustum(Particle * p)
 */
 void ParticleEmitter::hackToPath3D(algomath::Path<glm::vec3>& path, const std::vector<std::vector<algomath::NodeGraphTableEntry<glm::vec3>>>& hack)
 {
-	path.m_data.clear();
+	path.clear();
 	for (size_t i = 0; i < hack.size(); i++)
 	{
-		std::list<algomath::NodeGraphTableEntry<glm::vec3>> table;
-		for each (algomath::NodeGraphTableEntry<glm::vec3> tableEntry in hack[i])
-		{
-			table.push_back(tableEntry);
-		}
-		path.m_data.push_back(table);
+		path.addInterval(hack[i].begin(), hack[i].end());
 	}
 	path.updateDistances();
 }
@@ -341,44 +304,27 @@ void ParticleEmitter::hackToPath3D(algomath::Path<glm::vec3>& path, const std::v
 void ParticleEmitter::pathToHack3D(std::vector<std::vector<algomath::NodeGraphTableEntry<glm::vec3>>>& hack, algomath::Path<glm::vec3>& path)
 {
 	hack.clear();
-	for (int i = 0; i < path.m_data.size(); i++)
+	for (size_t i = 0; i < path.numIntervals(); i++)
 	{
-		std::vector<algomath::NodeGraphTableEntry<glm::vec3>> table;
-		auto tables = path.m_data[i];
-		for (auto i = tables.begin(); i != tables.end(); i++)
-		{
-			table.push_back(*i);
-		}
-		hack.push_back(table);
+		hack.push_back(std::vector<algomath::NodeGraphTableEntry<glm::vec3>>(path.intervalBegin(i), path.intervalEnd(i)));
 	}
 }
 
 void ParticleEmitter::hackToPath(algomath::Path<float>& path, const std::vector<std::vector<algomath::NodeGraphTableEntry<float>>>& hack)
 {
-	path.m_data.clear();
+	path.clear();
 	for (size_t i = 0; i < hack.size(); i++)
 	{
-		std::list<algomath::NodeGraphTableEntry<float>> table;
-		for each (algomath::NodeGraphTableEntry<float> tableEntry in hack[i])
-		{
-			table.push_back(tableEntry);
-		}
-		path.m_data.push_back(table);
+		path.addInterval(hack[i].begin(), hack[i].end());
 	}
 }
 
 void ParticleEmitter::pathToHack(std::vector<std::vector<algomath::NodeGraphTableEntry<float>>>& hack, const algomath::Path<float>& path)
 {
 	hack.clear();
-	for (int i = 0; i < path.m_data.size(); i++)
+	for (size_t i = 0; i < path.numIntervals(); i++)
 	{
-		std::vector<algomath::NodeGraphTableEntry<float>> table;
-		auto tables = path.m_data[i];
-		for (auto i = tables.begin(); i != tables.end(); i++)
-		{
-			table.push_back(*i);
-		}
-		hack.push_back(table);
+		hack.push_back(std::vector<algomath::NodeGraphTableEntry<float>>(path.intervalBegin(i), path.intervalEnd(i)));
 	}
 }
 
@@ -389,6 +335,20 @@ void ParticleEmitter::hacksToPaths()
 	hackToPath(myState.speedGraph, speedHack);
 	hackToPath(myState.sizeGraph, sizeHack);
 	hackToPath(myState.colourGraph, colourHack);
+
+	bakeGraphs();
+}
+
+/*
+ * @description resamples the size, speed and colour graphs into lookup tables
+ * @method bakeGraphs
+ * @return {void}
+ */
+void ParticleEmitter::bakeGraphs()
+{
+	myState.sizeCurve.bake(myState.sizeGraph);
+	myState.speedCurve.bake(myState.speedGraph);
+	myState.colourCurve.bake(myState.colourGraph);
 }
 
 void ParticleEmitter::pathsToHacks()
@@ -405,14 +365,15 @@ void ParticleEmitter::pathsToHacks()
  * @constructor
  */
 ParticleEmitter::ParticleEmitter()
-	: particles(nullptr),
-	myConfig(Config()),
+	: myConfig(Config()),
 	myState(ActiveState())
 {
 	initialize(100);
 
-	myConfig.numberOfParticles = 0;
+	freeMemory(); // no particles until setNumParticles is called
 	myConfig.playing = true;
+	myConfig.randomSeed = std::random_device()(); // saved files keep their seed, new emitters each get their own
+	myConfig.vectorFieldTransform.setScale(50.0f);
 }
 
 /*
@@ -432,20 +393,18 @@ ParticleEmitter::~ParticleEmitter()
  */
 void ParticleEmitter::initialize(unsigned int numParticles)
 {
-	freeMemory(); // destroy any existing particles
-	
+	// every particle goes, but the streams are kept for the new capacity unless they are far too big or too small
+	killParticles();
+	setNumParticles(numParticles);
 
-	if (numParticles > 0)
-	{
-		particles = new Particle[numParticles];
-		myConfig.numberOfParticles = numParticles;
-	}
+	restartRandom();
 
 	timeRemaining = myConfig.duration;
 
 	myState.sizeGraph = algomath::createDefaultTable<float>();
 	myState.speedGraph = algomath::createDefaultTable<float>();
 	myState.colourGraph = algomath::createDefaultTable<float>();
+	bakeGraphs();
 
 	//transforms
 	myConfig.transform.setPosition(glm::vec3(0.f));
@@ -537,17 +496,13 @@ void ParticleEmitter::initialize(unsigned int numParticles)
 }
 
 /*
- * @description sets the lifetime of all particles attached to this emitter to -1
+ * @description kills every particle attached to this emitter
  * @method killParticles
  * @return {void}
  */
 void ParticleEmitter::killParticles()
 {
-	Particle* particle = particles;
-	for (unsigned int i = 0; i < myConfig.numberOfParticles; ++i, ++particle)
-	{
-		particle->life = -1.0f;
-	}
+	particles.killAll();
 }
 
 /*
@@ -557,22 +512,236 @@ void ParticleEmitter::killParticles()
  */
 void ParticleEmitter::freeMemory()
 {
-	if (particles) // if not a null pointer
+	if (particles.capacity() > 0)
 	{
-		delete[] particles;
-		particles = nullptr;
+		particles.clear();
 		myConfig.numberOfParticles = 0;
 	}
 }
 
 /*
- * @description this method updates the emitter every frame
+ * @description this method updates the emitter every frame. big emitters are split into chunks that update on the thread pool
  * @method update
  * @params {float} dt - deltaTime
  * @return {void}
  */
 void ParticleEmitter::update(float dt)
 {
+	// outside of a ParticleSystem there are no sub-emitters to hand events to
+	birthEvents.clear();
+	deathEvents.clear();
+
+	unsigned int numChunks = beginUpdate(dt);
+
+	ThreadPool::global().parallelFor(numChunks, [this](unsigned int chunk)
+	{
+		updateChunk(chunk);
+	});
+
+	endUpdate();
+}
+
+/*
+ * @description the level of detail in use
+ * @method activeLod
+ * @return {const ParticleLodLevel&}
+ */
+const ParticleLodLevel& ParticleEmitter::activeLod() const
+{
+	static const ParticleLodLevel fullDetail = { 0.0f, 0.0f, 1.0f, 1.0f, 1, false };
+
+	// the budget pushes throttled emitters down the levels whether they use LOD or not
+	unsigned int level = (myConfig.lodEnabled ? lodLevel : 0) + budgetLodBias;
+	if (level == 0 && !myConfig.lodEnabled)
+	{
+		return fullDetail;
+	}
+	return myConfig.lodLevels[std::min(level, (unsigned int)PARTICLE_LOD_LEVELS - 1)];
+}
+
+/*
+ * @description moves lodLevel toward the level the view calls for, with hysteresis: a threshold has to be passed by
+ * lodHysteresis of itself before the level changes, so an emitter sitting right on a threshold doesn't flicker
+ * between levels. off screen emitters only need to be roughly right when they come back, so they take the last level
+ * @method selectLod
+ * @params {const ParticleRenderView&} view
+ * @return {void}
+ */
+void ParticleEmitter::selectLod(const ParticleRenderView& view)
+{
+	if (!myConfig.lodEnabled)
+	{
+		lodLevel = 0;
+		return;
+	}
+
+	ParticleBounds bounds = getBounds();
+	if (!ParticleFrustum(view).intersectsBox(bounds))
+	{
+		lodLevel = PARTICLE_LOD_LEVELS - 1;
+		return;
+	}
+
+	bool byDistance = (myConfig.lodMetric == LOD_DISTANCE);
+	float metric = glm::length(glm::vec3(worldMatrix[3]) - view.cameraPosition);
+	if (!byDistance)
+	{
+		// the sphere around the bounds. projection[1][1] is 1 / tan(fov / 2), so this is the sphere's diameter over the
+		// height of the view at the distance of its centre
+		float radius = glm::length(bounds.extent());
+		float distance = glm::length(bounds.centre() - view.cameraPosition);
+		metric = (distance > radius) ? radius * view.projectionMatrix[1][1] / distance : 1.0f;
+	}
+
+	float over = 1.0f + myConfig.lodHysteresis;
+	float under = 1.0f - myConfig.lodHysteresis;
+	auto coarser = [&](const ParticleLodLevel& level)
+	{
+		return byDistance ? metric > level.distance * over : metric < level.screenSize * under;
+	};
+	auto finer = [&](const ParticleLodLevel& level)
+	{
+		return byDistance ? metric < level.distance * under : metric > level.screenSize * over;
+	};
+
+	while (lodLevel + 1 < PARTICLE_LOD_LEVELS && coarser(myConfig.lodLevels[lodLevel + 1]))
+	{
+		++lodLevel;
+	}
+	while (lodLevel > 0 && finer(myConfig.lodLevels[lodLevel]))
+	{
+		--lodLevel;
+	}
+}
+
+/*
+ * @description time slicing. adds dt to the time owed and says whether this step should update, which is once every
+ * updateInterval steps. slot staggers emitters so the ones sharing an interval don't all update on the same step
+ * @method sliceStep
+ * @params {float} dt - the system's step
+ * @params {uint64_t} slot - the step number offset by something different for each emitter
+ * @return {float} the time to update by, 0 if the emitter sits this step out
+ */
+float ParticleEmitter::sliceStep(float dt, uint64_t slot)
+{
+	lodDt += dt;
+	++lodStepsPending;
+
+	unsigned int interval = activeLod().updateInterval;
+	if (interval > 1 && lodStepsPending < interval && slot % interval != 0)
+	{
+		return 0.0f;
+	}
+
+	float sliceDt = lodDt;
+	lodLastUpdateSteps = lodStepsPending;
+	lodDt = 0.0f;
+	lodStepsPending = 0;
+	return sliceDt;
+}
+
+/*
+ * @description previousPosition and position are lodLastUpdateSteps apart, and lodStepsPending steps have gone by
+ * since the last update, so draw that far between them
+ * @method lodInterpolation
+ * @params {float} interpolation - fraction of a system step
+ * @return {float} fraction of the last update
+ */
+float ParticleEmitter::lodInterpolation(float interpolation) const
+{
+	return glm::min((lodStepsPending + interpolation) / (float)lodLastUpdateSteps, 1.0f);
+}
+
+/*
+ * @description fast forwards the emitter on its own, stepping by prewarmStep instead of the frame time. chunks still
+ * run on every worker, and emitters that qualify for analytic motion only age their particles each step
+ * @method prewarm
+ * @params {float} seconds - how far to fast forward, lifeRange.y is enough to reach a looping effect's steady state
+ * @return {float} milliseconds it took
+ */
+float ParticleEmitter::prewarm(float seconds)
+{
+	double start = algomath::timeMilliseconds();
+	float step = prewarmStep();
+
+	prewarming = true;
+	while (seconds > 0.0f)
+	{
+		float dt = (seconds < step) ? seconds : step;
+		update(dt);
+		seconds -= dt;
+	}
+	prewarming = false;
+
+	return (float)(algomath::timeMilliseconds() - start);
+}
+
+/*
+ * @description the step prewarm takes. analytic emitters can take far bigger steps than integrated ones
+ * @method prewarmStep
+ * @return {float}
+ */
+float ParticleEmitter::prewarmStep() const
+{
+	return (getUpdateFlags() & UPDATE_ANALYTIC) ? PARTICLE_PREWARM_ANALYTIC_STEP : PARTICLE_PREWARM_STEP;
+}
+
+/*
+ * @description a big step spawns everything that came due during it at once. this moves each new particle back to
+ * when it was due: particle j of count was due (j + 1) / count of the way through the step, so it starts that much
+ * younger and, when integrated, that much further back along its velocity. after the step it is where it would
+ * have been had it spawned on time
+ * @method backdateSpawns
+ * @params {unsigned int} first - index of the first new particle
+ * @params {unsigned int} count - number of new particles
+ * @params {float} dt - the step they were spawned in
+ * @return {void}
+ */
+void ParticleEmitter::backdateSpawns(unsigned int first, unsigned int count, float dt)
+{
+	bool analytic = (kernels.flags & UPDATE_ANALYTIC) != 0;
+	for (unsigned int j = 0; j < count; ++j)
+	{
+		unsigned int idx = first + j;
+		float late = dt * (float)(j + 1) / (float)count;
+
+		// analytic particles start at a negative age, evaluating to the same point the integrated ones are moved back to
+		particles.life[idx] += late;
+		if (!analytic)
+		{
+			glm::vec3 position = particles.position.get(idx) - particles.velocity.get(idx) * late;
+			particles.position.set(idx, position);
+			particles.previousPosition.set(idx, position);
+		}
+	}
+}
+
+/*
+ * @description first stage of an update. moves the emitter and spawns this frame's particles on the calling thread,
+ * so emission order is the same no matter how many threads run the chunks
+ * @method beginUpdate
+ * @params {float} dt - deltaTime
+ * @return {unsigned int} number of chunks to pass to updateChunk
+ */
+unsigned int ParticleEmitter::beginUpdate(float dt)
+{
+	updateDt = dt;
+	numUpdateChunks = 0;
+	selectKernels(); // Config may have been edited since the last update
+	syncAnalyticMotion();
+	reserveEventBuffers();
+
+	colliderShapes.resize(myState.colliders.size());
+	for (size_t i = 0; i < myState.colliders.size(); ++i)
+	{
+		colliderShapes[i] = algomath::prepareCollider(myState.colliders[i]);
+	}
+
+	if (kernels.flags & UPDATE_VECTOR_FIELD)
+	{
+		prepareVectorField();
+	}
+
 	// update emitter
 	glm::vec3 rotation = myConfig.rotationalVelocity * dt;
 	myConfig.transform.rotateXYZ(rotation);
@@ -580,7 +749,13 @@ void ParticleEmitter::update(float dt)
 
 	// update particles
 
-	if (particles && myConfig.playing) // make sure memory is initialized and system is playing
+	// auto capacity only grows, so an edit that briefly asks for less doesn't kill particles
+	if (myConfig.autoCapacity && myConfig.playing && autoCapacity() > particles.capacity())
+	{
+		setNumParticles(autoCapacity());
+	}
+
+	if (particles.capacity() > 0 && myConfig.playing) // make sure memory is initialized and system is playing
 	{
 		emissionTime += dt;
 		timeRemaining -= dt;
@@ -601,305 +776,1357 @@ void ParticleEmitter::update(float dt)
 			}
 		}
 
-		unsigned int NumParticlesToEmit = emissionTime * myConfig.emissionRate;
+		// lower levels of detail and the budget emit less and fill less of the pool
+		const ParticleLodLevel& lod = activeLod();
+		float emissionRate = myConfig.emissionRate * lod.emissionScale * budgetEmissionScale;
+		unsigned int lodCapacity = (unsigned int)(particles.capacity() * algomath::clamp(lod.capacityScale, 0.0f, 1.0f));
+		unsigned int capacity = std::min(lodCapacity, budgetQuota);
+		if (emissionRate <= 0.0f)
+		{
+			emissionTime = 0.0f; // nothing comes due while the level emits nothing
+		}
+
+		unsigned int NumParticlesToEmit = emissionTime * emissionRate;
+
+		unsigned int numToSpawn = (capacity > particles.numAlive()) ? capacity - particles.numAlive() : 0;
+		if (NumParticlesToEmit < numToSpawn)
+		{
+			numToSpawn = NumParticlesToEmit;
+		}
+		else if (capacity < lodCapacity)
+		{
+			// count what the quota held back, against what would have fit without it
+			unsigned int room = (lodCapacity > particles.numAlive()) ? lodCapacity - particles.numAlive() : 0;
+			budgetDenied += std::min(NumParticlesToEmit, room) - numToSpawn;
+		}
 
-		// loop through each particle
-		Particle* particle = particles;
-		for (unsigned int i = 0; i < myConfig.numberOfParticles; ++i, ++particle)
+		if (numToSpawn > 0)
 		{
-			if (particle->life <= 0.0f) // if particle has no life remaining
+			unsigned int first = spawnBatch(numToSpawn);
+			if (prewarming)
+			{
+				backdateSpawns(first, numToSpawn, dt);
+			}
+			if (myConfig.birthSubEmitter >= 0)
 			{
-				if (NumParticlesToEmit > 0)
+				for (unsigned int i = first; i < particles.numAlive(); ++i)
 				{
-					spawnParticle(particle);
-					NumParticlesToEmit--;
-					emissionTime -= (1.0f / myConfig.emissionRate); //subtract the time it takes to spawn a particle
-					updateParticle(particle, dt);
+					recordEvent(birthEvents, i);
 				}
-				else continue; // don't update a dead particle
 			}
-			else
+			if (analyticMotion.active)
 			{
-				updateParticle(particle, dt);
+				addFlightBounds(first, particles.numAlive(), localBounds);
 			}
+			emissionTime -= numToSpawn / emissionRate; //subtract the time it takes to spawn the particles
 		}
-	}
-}
-
-/*
- * @description checks which behaviours are active for each particle and 
- * calls the particle update method
- * @method updateParticle
- * @params {Particle *} particle
- * @params {const float&} dt - delta time
- * @return {void}
- */
-void ParticleEmitter::updateParticle(Particle * particle, const float& dt)
-{
-	// Update physics
-	if (myConfig.seekingBehaviours)
-	{
-		particle->force += particle->seek(myConfig.seekPoint, myConfig.seekForce);
-		particle->force += particle->gravitate(myConfig.gravitatePoint, myConfig.gravitatePower, myConfig.gravitateMaxForce);
-		particle->force += particle->attract(myConfig.attractPoint, myConfig.attractForce, myConfig.attractRange);
-	}
-	if (myConfig.steeringBehaviours)
-	{
-		particle->force += particle->steer(myConfig.steerPoint, myConfig.steerForce, myConfig.steerMaxForce);
-		particle->force += particle->arrive(myConfig.arrivePoint, myConfig.arriveForce, myConfig.arriveRange, myConfig.arriveMaxForce);
-	}
 
-	if (myConfig.globalEffects)
-	{
-		particle->force += myConfig.globalForceVector;
-		particle->acceleration += myConfig.globalAccelerationVector;
-	}
-
-	if (myConfig.followPath)
-	{
-		if (myConfig.directFollowMode)
+		numUpdateChunks = (particles.numAlive() + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+		if (!analyticMotion.active)
 		{
-			applyDirectPathFollow(dt, particle);
+			chunkBounds.resize((size_t)numUpdateChunks * 6);
+			for (unsigned int chunk = 0; chunk < numUpdateChunks; ++chunk)
+			{
+				float* bounds = &chunkBounds[(size_t)chunk * 6];
+				bounds[0] = bounds[1] = bounds[2] = FLT_MAX;
+				bounds[3] = bounds[4] = bounds[5] = -FLT_MAX;
+			}
 		}
-		else
+
+		// chunks move their particles while others are still looking for neighbours, so flocking reads this snapshot instead
+		if (kernels.flags & UPDATE_FLOCK)
 		{
-			applyPathSteering(dt, particle);
+			neighbourGrid.build(particles.position.x.data(), particles.position.y.data(), particles.position.z.data(),
+				particles.velocity.x.data(), particles.velocity.y.data(), particles.velocity.z.data(),
+				particles.numAlive(), myConfig.flockRadius, myConfig.mortonOrderGrid);
 		}
 	}
 
+	return numUpdateChunks;
+}
 
-	float normalizedLife = algomath::clamp(1.0f - (particle->life / particle->lifespan), 0.0f, 1.0f);
-
-	if (myConfig.sizeOverLifetime)
+/*
+ * @description spawns count particles on the end of the alive range. every particle owns the random stream numbered by
+ * its spawn order, so it gets the same numbers however the work is split up. the caller makes sure there is room
+ * @method spawnBatch
+ * @params {unsigned int} count
+ * @return {unsigned int} index of the first new particle
+ */
+unsigned int ParticleEmitter::spawnBatch(unsigned int count)
+{
+	random.setSeed(myConfig.randomSeed);
+	spawnRandoms.resize((size_t)count * PARTICLE_SPAWN_RANDOMS);
+	random.fillUniformBatch(spawnSerial, count, PARTICLE_SPAWN_RANDOMS, spawnRandoms.data());
+	spawnSerial += count;
+
+	// new particles get updated with everything else
+	unsigned int first = particles.numAlive();
+	for (unsigned int i = 0; i < count; ++i)
 	{
-		float normalizedSize = myState.sizeGraph.lookupValue(normalizedLife);
-		float size = algomath::lerp(particle->sizeBegin, particle->sizeEnd, normalizedSize);
-		particle->transform.setScale(size);
+		spawnParticle(particles.spawn(), &spawnRandoms[(size_t)i * PARTICLE_SPAWN_RANDOMS]);
 	}
+	return first;
+}
 
-	if (myConfig.colourOverLifetime)
+/*
+ * @description spawns particlesPerEvent particles at every event, all in one batch. the emission shape is laid out
+ * around the event instead of the emitter, and the event's velocity is added scaled by inheritVelocity
+ * @method spawnFromEvents
+ * @params {const ParticleEventBuffer&} events - recorded by another emitter, in world space
+ * @return {void}
+ */
+void ParticleEmitter::spawnFromEvents(const ParticleEventBuffer& events)
+{
+	// the level of detail and the budget cap event spawns the same way they cap emission in beginUpdate
+	unsigned int lodCapacity = (unsigned int)(particles.capacity() * algomath::clamp(activeLod().capacityScale, 0.0f, 1.0f));
+	unsigned int capacity = std::min(lodCapacity, budgetQuota);
+	if (events.count == 0 || particles.numAlive() >= capacity)
 	{
-		float normalizedColour = myState.colourGraph.lookupValue(normalizedLife);
-		glm::vec4 colour = algomath::lerp(particle->colourBegin, particle->colourEnd, normalizedColour);
-		particle->colour = colour;
+		return;
 	}
 
-	// Update position
-	particle->update(dt);
-
-	if (myConfig.limitSpeedOverLifetime)
+	unsigned int perEvent = (myConfig.particlesPerEvent > 0) ? myConfig.particlesPerEvent : 1;
+	unsigned int numToSpawn = capacity - particles.numAlive();
+	if ((uint64_t)events.count * perEvent < numToSpawn)
 	{
-		float normalizedSpeed = myState.speedGraph.lookupValue(normalizedLife);
-		float speed = algomath::lerp(particle->speedLimitBegin, particle->speedLimitEnd, normalizedSpeed);
-
-		particle->velocity = algomath::limitMagnitude(particle->velocity, speed);
+		numToSpawn = events.count * perEvent;
 	}
 
-	particle->transform.move(particle->velocity * dt);
+	// spawnParticle put the particles around this emitter, so move them from here to the event
+	glm::mat4 toEmitter = glm::inverse(worldMatrix);
+	glm::mat3 toEmitterRotation = glm::mat3(toEmitter);
+	glm::vec3 origin = glm::vec3(worldMatrix[3]);
 
-#ifdef _DEBUG
-	if (isnan(particle->transform.getPosition().x))
+	unsigned int first = spawnBatch(numToSpawn);
+	for (unsigned int i = 0; i < numToSpawn; ++i)
 	{
-		printf("NaN at particle %u ", particle);
+		unsigned int idx = first + i;
+		unsigned int event = i / perEvent;
 
-		if (isnan(particle->force.x))
+		glm::vec3 offset = events.position.get(event);
+		glm::vec3 velocity = events.velocity.get(event) * myConfig.inheritVelocity;
+		if (myConfig.parentTransforms)
 		{
-			printf("force! ");
+			offset = glm::vec3(toEmitter * glm::vec4(offset, 1.0f));
+			velocity = toEmitterRotation * velocity;
 		}
-
-		if (isnan(particle->acceleration.x))
+		else
 		{
-			printf("accel! ");
+			offset -= origin;
 		}
 
-		if (isnan(particle->velocity.x))
+		particles.position.add(idx, offset);
+		particles.previousPosition.add(idx, offset);
+		particles.velocity.add(idx, velocity);
+
+		if (myConfig.birthSubEmitter >= 0)
 		{
-			printf("vel! ");
+			recordEvent(birthEvents, idx);
 		}
-
-		printf("pos! mass: %f, life: %f, lifespan: %f\n", particle->mass, particle->life, particle->lifespan);
 	}
-#endif
 
-	if (myConfig.parentTransforms)
+	// these spawned after the update measured the bounds, so they are added here to be drawn before the next one
+	if (analyticMotion.active)
 	{
-		particle->worldMatrix = worldMatrix * particle->transform.getTransform();
-//#ifdef _DEBUG
-//		if (isnan(transform.getPosition().x))
-//		{
-//			printf("transform has NaN!\n");
-//		}
-//#endif
+		addFlightBounds(first, first + numToSpawn, localBounds);
 	}
 	else
 	{
-		particle->worldMatrix = particle->transform.getTransform();
+		for (unsigned int idx = first; idx < first + numToSpawn; ++idx)
+		{
+			localBounds.add(particles.position.get(idx));
+		}
 	}
-	//else
-	//{
-	//	particle->transform.setParentTransform(nullptr);
-	//}
-
-	particle->life -= dt;
 }
 
 /*
- * @description this method draws the particle emitter and all attached particles
- * @method draw
+ * @description adds particle idx to an event buffer, in world space so any emitter can spawn from it
+ * @method recordEvent
+ * @params {ParticleEventBuffer&} events
+ * @params {unsigned int} idx - index of the particle
  * @return {void}
  */
-void ParticleEmitter::draw()
+inline void ParticleEmitter::recordEvent(ParticleEventBuffer& events, unsigned int idx)
 {
-	Particle* p = particles;
-	for (int i = 0; i < myConfig.numberOfParticles; ++i, ++p)
+	glm::vec3 position = particles.position.get(idx);
+	glm::vec3 velocity = particles.velocity.get(idx);
+	if (analyticMotion.active)
 	{
-		if (p->life > 0.0f) // if particle is alive, draw it
-		{
-			//viewfrustum call - only draw particles on screen
-			p->draw();
-		}
+		position = evaluatePosition(idx, particleAge(idx));
+		velocity = evaluateVelocity(idx, particleAge(idx));
+	}
+	if (myConfig.parentTransforms)
+	{
+		position = glm::vec3(worldMatrix * glm::vec4(position, 1.0f));
+		velocity = glm::mat3(worldMatrix) * velocity;
 	}
+	events.push(position, velocity);
 }
 
 /*
- * @description this method spawns each particle according to paramater options assigned
- * @method spawnParticle
- * @params {Particle *} p - a pointer to each particle
+ * @description sizes the event buffers of linked sub-emitters to the pool's allocation, which is at least the most
+ * particles that can be born or die in one step. only allocates when the pool reallocates or the links change, never per
+ * event, and the pool's geometric growth keeps that rare while capacity is being edited
+ * @method reserveEventBuffers
  * @return {void}
  */
-inline void ParticleEmitter::spawnParticle(Particle * p)
+void ParticleEmitter::reserveEventBuffers()
 {
-	//p->mesh = meshes["sphere"];meshes["sphere"]->vertices.size()
-	
-	p->colourBegin = algomath::lerp(myConfig.colourBegin0, myConfig.colourBegin1, RANDOM);
-	p->colourEnd = algomath::lerp(myConfig.colourEnd0, myConfig.colourEnd1, RANDOM);
-
-	p->lifespan = algomath::lerp(myConfig.lifeRange.x, myConfig.lifeRange.y, RANDOM);
-	p->life = p->lifespan;
+	unsigned int birthCapacity = (myConfig.birthSubEmitter >= 0) ? particles.allocated() : 0;
+	unsigned int deathCapacity = (myConfig.deathSubEmitter >= 0) ? particles.allocated() : 0;
 
-	float randomTval_A = glm::linearRand(0.0f, 1.0f);
-	//couple mass and size relationship
-	p->mass = algomath::lerp(myConfig.massRange.x, myConfig.massRange.y, randomTval_A);
-	p->sizeBegin = algomath::lerp(myConfig.sizeRangeBegin.x, myConfig.sizeRangeBegin.y, randomTval_A);
-	p->sizeEnd = algomath::lerp(myConfig.sizeRangeEnd.x, myConfig.sizeRangeEnd.y, randomTval_A);
-
-	//emission shapes determine initial velocity and position distribution
-	switch (myConfig.emissionShape)
-	{
-	case CUBOID:
-	{
-		emitFromCuboid(p);
-		break;
-	}
-	case FRUSTUM:
+	if (birthEvents.capacity() != birthCapacity)
 	{
-		emitFromFrustum(p);
-		break;
+		birthEvents.reserve(birthCapacity);
 	}
-	default:
-	case SPHERE:
+	if (deathEvents.capacity() != deathCapacity)
 	{
-		emitFromSphere(p);
-		break;
+		deathEvents.reserve(deathCapacity);
 	}
-	}
-	//emit functions will set a position and a normalized velocity 
-
-	float startspeed = glm::linearRand(myConfig.initialSpeedRange.x, myConfig.initialSpeedRange.y);
-	p->velocity = p->velocity * startspeed;
-	p->transform.move(myConfig.emitterOffset);
-
-
-	p->speedLimitBegin = glm::linearRand(myConfig.initialSpeedLimitRange.x, myConfig.initialSpeedLimitRange.y);
-	p->speedLimitEnd = glm::linearRand(myConfig.finalSpeedLimitRange.x, myConfig.finalSpeedLimitRange.y);
-
-	p->distanceTravelledAlongPath = 0.0f;
+}
 
-	if (!myConfig.parentTransforms)
+/*
+ * @description updates one fixed size block of living particles. chunks never overlap, so they can run on any thread
+ * @method updateChunk
+ * @params {unsigned int} chunk - index of the chunk, less than the value returned by beginUpdate
+ * @return {void}
+ */
+void ParticleEmitter::updateChunk(unsigned int chunk)
+{
+	unsigned int begin = chunk * PARTICLE_CHUNK_SIZE;
+	unsigned int end = begin + PARTICLE_CHUNK_SIZE;
+	if (end > particles.numAlive())
 	{
-		p->velocity = myConfig.transform.getRotationMatrix() * glm::vec4(p->velocity, 1.0f);
-		p->transform.setPosition(worldMatrix * glm::vec4(p->transform.getPosition(), 1.0f));
+		end = particles.numAlive();
 	}
 
-	p->transform.setScale(p->sizeBegin);
-	p->colour = p->colourBegin;
+	updateParticles(begin, end, updateDt);
 }
 
 /*
- * @description this method applies steering behaviour to each particle
- * @method applyPathSteering
- * @params {const float&} dt - deltaTime
- * @params {Particle *} particle - a pointer to each particle
+ * @description last stage of an update. retires dead particles on the calling thread once every chunk is done
+ * @method endUpdate
  * @return {void}
  */
-void ParticleEmitter::applyPathSteering(const float& dt, Particle* particle)
+void ParticleEmitter::endUpdate()
 {
-	//todo: optimizations e.g. have particles store their interval so i dont have to search it
-
-	particle->distanceTravelledAlongPath = fmod(particle->distanceTravelledAlongPath, myState.path.getLength());//fmod(particle->distanceTravelledAlongPath, path.getLength());
-	size_t numIntervals = myState.path.numIntervals();
-	// find interval
-	unsigned int interval = myState.path.lookupInterval(particle->distanceTravelledAlongPath);
-	std::list<algomath::NodeGraphTableEntry<glm::vec3>>::iterator current = myState.path.iterByDist(interval, particle->distanceTravelledAlongPath);
-	std::list<algomath::NodeGraphTableEntry<glm::vec3>>::iterator next = std::next(current);
-
-	glm::vec3 proj;
-	glm::vec3 pathVec; // the current segment for the path
-	glm::vec3 futurePosition = particle->transform.getPosition() + (particle->velocity *  dt);
-	glm::vec3 pathTarget;
-
-	if (next != myState.path.m_data[interval].end())
+	if (numUpdateChunks == 0)
 	{
-		pathVec = next->val - current->val;
-		proj = glm::proj(futurePosition - current->val, pathVec);
+		return;
 	}
-	else
+	// particles that die below are still inside the bounds, which only makes them a little generous until the next update
+	if (analyticMotion.active)
 	{
-		if (interval == numIntervals - 1u)
+		if (boundsRebuildCountdown == 0)
 		{
-			pathVec = current->val - std::prev(current)->val;
-			float scalarProj = algomath::scalarProj(futurePosition, pathVec);
-			proj = pathVec * scalarProj;
-			if (isnan(proj.x))
-			{
-				proj = glm::vec3(0.0f);
-			}
+			rebuildBounds();
 		}
 		else
 		{
-			// line to next interval
-			pathVec = std::next(myState.path.m_data[interval + 1u].begin())->val - current->val;//next = std::next(path.m_data[interval + 1u].begin());
-			proj = glm::proj(futurePosition - current->val, pathVec);
+			--boundsRebuildCountdown;
 		}
 	}
+	else
+	{
+		localBounds = ParticleBounds();
+		for (unsigned int chunk = 0; chunk < numUpdateChunks; ++chunk)
+		{
+			const float* bounds = &chunkBounds[(size_t)chunk * 6];
+			localBounds.add(glm::vec3(bounds[0], bounds[1], bounds[2]));
+			localBounds.add(glm::vec3(bounds[3], bounds[4], bounds[5]));
+		}
+	}
+	numUpdateChunks = 0;
 
-
-	if (glm::length2(proj + current->val - futurePosition) > (myConfig.pathRadius * myConfig.pathRadius)) // if distance to the path is greater than a threshold
+	// the last living particle moves into i, so check i again
+	const float* life = particles.life.data();
+	bool recordDeaths = (myConfig.deathSubEmitter >= 0);
+	for (unsigned int i = 0; i < particles.numAlive();)
 	{
-		pathTarget = myState.path.lookupValue(fmod((particle->distanceTravelledAlongPath + myConfig.lookAhead), myState.path.getLength()));
-		particle->force += particle->steer(pathTarget, myConfig.pathPower, myConfig.pathPower);
+		if (life[i] <= 0.0f)
+		{
+			if (recordDeaths)
+			{
+				recordEvent(deathEvents, i);
+			}
+			particles.kill(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+/*
+ * @description updates the particles in [begin, end) in passes: behaviours accumulate forces, lifetime graphs are sampled,
+ * then a SIMD kernel integrates the whole range at once. world matrices are left to draw.
+ * the behaviour passes are the kernels picked by selectKernels, so none of them test Config flags per particle
+ * @method updateParticles
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @params {const float&} dt - delta time
+ * @return {void}
+ */
+void ParticleEmitter::updateParticles(unsigned int begin, unsigned int end, const float& dt)
+{
+	// the streams hold spawn state, positions and lifetime graphs are worked out from the age when they are needed
+	if (kernels.flags & UPDATE_ANALYTIC)
+	{
+		float* life = particles.life.data();
+		for (unsigned int idx = begin; idx < end; ++idx)
+		{
+			life[idx] -= dt;
+		}
+		return;
+	}
+
+	// keep where the particles were so draw can interpolate between steps
+	size_t count = end - begin;
+	memcpy(&particles.previousPosition.x[begin], &particles.position.x[begin], count * sizeof(float));
+	memcpy(&particles.previousPosition.y[begin], &particles.position.y[begin], count * sizeof(float));
+	memcpy(&particles.previousPosition.z[begin], &particles.position.z[begin], count * sizeof(float));
+
+	(this->*kernels.forces)(begin, end, dt);
+	if (kernels.flags & UPDATE_FLOCK)
+	{
+		applyFlocking(begin, end);
+	}
+	if (kernels.flags & UPDATE_VECTOR_FIELD)
+	{
+		applyVectorField(begin, end);
+	}
+	(this->*kernels.lifetime)(begin, end);
+
+	integrateParticles(begin, end, dt);
+	collideParticles(begin, end);
+	if (!colliderShapes.empty())
+	{
+		// integration already measured these, but colliders may have pushed some out past that
+		algomath::boundParticles(particles.position.x.data(), particles.position.y.data(), particles.position.z.data(),
+			begin, end, chunkBoundsFor(begin));
+	}
+
+	checkParticles(begin, end);
+}
+
+/*
+ * @description packs the Config flags that change which update code runs into an UPDATE_FLAGS mask
+ * @method getUpdateFlags
+ * @return {unsigned int}
+ */
+unsigned int ParticleEmitter::getUpdateFlags() const
+{
+	unsigned int flags = 0;
+	if (myConfig.seekingBehaviours) flags |= UPDATE_SEEK;
+	if (myConfig.steeringBehaviours) flags |= UPDATE_STEER;
+	if (myConfig.globalEffects) flags |= UPDATE_GLOBAL_EFFECTS;
+	if (myConfig.followPath) flags |= UPDATE_FOLLOW_PATH;
+	if (myConfig.directFollowMode) flags |= UPDATE_DIRECT_FOLLOW;
+	if (myConfig.sizeOverLifetime) flags |= UPDATE_SIZE_OVER_LIFETIME;
+	if (myConfig.colourOverLifetime) flags |= UPDATE_COLOUR_OVER_LIFETIME;
+	if (myConfig.limitSpeedOverLifetime) flags |= UPDATE_LIMIT_SPEED;
+	if (myConfig.flockingBehaviours) flags |= UPDATE_FLOCK;
+	if (myConfig.vectorFieldEffects) flags |= UPDATE_VECTOR_FIELD;
+	if (activeLod().reducedBehaviours) flags &= ~UPDATE_EXPENSIVE;
+	if (myConfig.analyticMotion && canUseAnalyticMotion(flags)) flags |= UPDATE_ANALYTIC;
+	return flags;
+}
+
+/*
+ * @description whether the particles can move in closed form. they can as long as the only things acting on them are
+ * the uniform force and acceleration, which are the same for the whole life of the particle
+ * @method canUseAnalyticMotion
+ * @params {unsigned int} flags - the behaviours that will run, so a reduced level of detail can go analytic
+ * @return {bool}
+ */
+bool ParticleEmitter::canUseAnalyticMotion(unsigned int flags) const
+{
+	return (flags & UPDATE_NOT_ANALYTIC) == 0 && myState.colliders.empty();
+}
+
+/*
+ * @description where particle idx is at the given age. p = p0 + v0 * t + a * t^2 / 2, with the spawn state in the streams.
+ * the exact curve, where integration is a step behind it by a * t * dt / 2
+ * @method evaluatePosition
+ * @params {unsigned int} idx - index of the particle
+ * @params {float} age - seconds since the particle spawned, any age can be asked for
+ * @return {glm::vec3}
+ */
+glm::vec3 ParticleEmitter::evaluatePosition(unsigned int idx, float age) const
+{
+	glm::vec3 acceleration = analyticMotion.acceleration + analyticMotion.force / particles.mass[idx];
+	return particles.position.get(idx) + particles.velocity.get(idx) * age + acceleration * (0.5f * age * age);
+}
+
+/*
+ * @description velocity of particle idx at the given age, v = v0 + a * t
+ * @method evaluateVelocity
+ * @params {unsigned int} idx - index of the particle
+ * @params {float} age - seconds since the particle spawned
+ * @return {glm::vec3}
+ */
+glm::vec3 ParticleEmitter::evaluateVelocity(unsigned int idx, float age) const
+{
+	glm::vec3 acceleration = analyticMotion.acceleration + analyticMotion.force / particles.mass[idx];
+	return particles.velocity.get(idx) + acceleration * age;
+}
+
+/*
+ * @description keeps the streams in step with the update flags. switching to integration bakes the particles' current
+ * state into the streams, switching to analytic motion turns it back into spawn state, and editing the uniform
+ * effects does both so particles carry on from where they are instead of jumping onto the new curve
+ * @method syncAnalyticMotion
+ * @return {void}
+ */
+void ParticleEmitter::syncAnalyticMotion()
+{
+	bool analytic = (kernels.flags & UPDATE_ANALYTIC) != 0;
+	glm::vec3 acceleration = myConfig.globalEffects ? myConfig.globalAccelerationVector : glm::vec3(0.0f);
+	glm::vec3 force = myConfig.globalEffects ? myConfig.globalForceVector : glm::vec3(0.0f);
+
+	if (analytic == analyticMotion.active
+		&& (!analytic || (acceleration == analyticMotion.acceleration && force == analyticMotion.force)))
+	{
+		return;
+	}
+
+	if (analyticMotion.active)
+	{
+		bakeAnalyticMotion();
+	}
+
+	analyticMotion.active = analytic;
+	analyticMotion.acceleration = acceleration;
+	analyticMotion.force = force;
+
+	if (analytic)
+	{
+		rebaseAnalyticMotion();
+	}
+	boundsRebuildCountdown = 0; // the particles' flights changed, so their bounds are rebuilt at the end of this update
+}
+
+/*
+ * @description replaces the spawn state in the streams with where every particle is now
+ * @method bakeAnalyticMotion
+ * @return {void}
+ */
+void ParticleEmitter::bakeAnalyticMotion()
+{
+	for (unsigned int idx = 0; idx < particles.numAlive(); ++idx)
+	{
+		float age = particleAge(idx);
+		glm::vec3 position = evaluatePosition(idx, age);
+		glm::vec3 velocity = evaluateVelocity(idx, age);
+		particles.position.set(idx, position);
+		particles.previousPosition.set(idx, position);
+		particles.velocity.set(idx, velocity);
+	}
+}
+
+/*
+ * @description replaces the current state in the streams with the spawn state that reaches it under analyticMotion,
+ * v0 = v - a * t and p0 = p - v * t + a * t^2 / 2
+ * @method rebaseAnalyticMotion
+ * @return {void}
+ */
+void ParticleEmitter::rebaseAnalyticMotion()
+{
+	for (unsigned int idx = 0; idx < particles.numAlive(); ++idx)
+	{
+		float age = particleAge(idx);
+		glm::vec3 acceleration = analyticMotion.acceleration + analyticMotion.force / particles.mass[idx];
+		glm::vec3 position = particles.position.get(idx);
+		glm::vec3 velocity = particles.velocity.get(idx);
+		particles.position.set(idx, position - velocity * age + acceleration * (0.5f * age * age));
+		particles.velocity.set(idx, velocity - acceleration * age);
+	}
+}
+
+namespace
+{
+	// one instantiation per combination of flags each kernel cares about, indexed by those bits of the UPDATE_FLAGS mask.
+	// a direct follow bit without the follow path bit ends up at the same instantiation as no path following
+	template<unsigned int MASK>
+	ParticleEmitter::ForceKernel forceKernelFor()
+	{
+		return &ParticleEmitter::accumulateForces<
+			(MASK & ParticleEmitter::UPDATE_SEEK) != 0,
+			(MASK & ParticleEmitter::UPDATE_STEER) != 0,
+			(MASK & ParticleEmitter::UPDATE_GLOBAL_EFFECTS) != 0,
+			(MASK & ParticleEmitter::UPDATE_FOLLOW_PATH) != 0,
+			(MASK & ParticleEmitter::UPDATE_DIRECT_FOLLOW) != 0>;
+	}
+
+	template<unsigned int MASK>
+	ParticleEmitter::LifetimeKernel lifetimeKernelFor()
+	{
+		return &ParticleEmitter::updateLifetime<
+			(MASK & (ParticleEmitter::UPDATE_SIZE_OVER_LIFETIME >> ParticleEmitter::LIFETIME_FLAGS_SHIFT)) != 0,
+			(MASK & (ParticleEmitter::UPDATE_COLOUR_OVER_LIFETIME >> ParticleEmitter::LIFETIME_FLAGS_SHIFT)) != 0,
+			(MASK & (ParticleEmitter::UPDATE_LIMIT_SPEED >> ParticleEmitter::LIFETIME_FLAGS_SHIFT)) != 0>;
+	}
+
+	template<size_t... MASKS>
+	const ParticleEmitter::ForceKernel* forceKernelTable(std::index_sequence<MASKS...>)
+	{
+		static const ParticleEmitter::ForceKernel table[] = { forceKernelFor<MASKS>()... };
+		return table;
+	}
+
+	template<size_t... MASKS>
+	const ParticleEmitter::LifetimeKernel* lifetimeKernelTable(std::index_sequence<MASKS...>)
+	{
+		static const ParticleEmitter::LifetimeKernel table[] = { lifetimeKernelFor<MASKS>()... };
+		return table;
+	}
+}
+
+/*
+ * @description picks the kernel instantiations that match the current Config flags. only does any work when the flags changed
+ * @method selectKernels
+ * @return {void}
+ */
+void ParticleEmitter::selectKernels()
+{
+	unsigned int flags = getUpdateFlags();
+	if (flags == kernels.flags)
+	{
+		return;
+	}
+
+	static const ForceKernel* forceTable = forceKernelTable(std::make_index_sequence<1 << LIFETIME_FLAGS_SHIFT>());
+	static const LifetimeKernel* lifetimeTable = lifetimeKernelTable(std::make_index_sequence<1 << (LIFETIME_FLAGS_END - LIFETIME_FLAGS_SHIFT)>());
+
+	kernels.flags = flags;
+	kernels.forces = forceTable[flags & ((1 << LIFETIME_FLAGS_SHIFT) - 1)];
+	kernels.lifetime = lifetimeTable[(flags >> LIFETIME_FLAGS_SHIFT) & ((1 << (LIFETIME_FLAGS_END - LIFETIME_FLAGS_SHIFT)) - 1)];
+}
+
+/*
+ * @description accumulates the force and acceleration of every particle in [begin, end) from the enabled behaviours.
+ * the flags are template parameters so each combination compiles to its own loop with no per-particle branching on Config
+ * @method accumulateForces
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @params {float} dt - delta time
+ * @return {void}
+ */
+template<bool SEEK, bool STEER, bool GLOBAL_EFFECTS, bool FOLLOW_PATH, bool DIRECT_FOLLOW>
+void ParticleEmitter::accumulateForces(unsigned int begin, unsigned int end, float dt)
+{
+	if (!SEEK && !STEER && !GLOBAL_EFFECTS && !FOLLOW_PATH)
+	{
+		return; // integration already starts from the force and acceleration left in the streams
+	}
+
+	for (unsigned int idx = begin; idx < end; ++idx)
+	{
+		glm::vec3 position = particles.position.get(idx);
+		glm::vec3 velocity = particles.velocity.get(idx);
+		glm::vec3 force = particles.force.get(idx);
+
+		// Update physics
+		if (SEEK)
+		{
+			force += algomath::seek(position, myConfig.seekPoint, myConfig.seekForce);
+			force += algomath::gravitate(position, myConfig.gravitatePoint, myConfig.gravitatePower, myConfig.gravitateMaxForce);
+			force += algomath::attract(position, velocity, myConfig.attractPoint, myConfig.attractForce, myConfig.attractRange);
+		}
+		if (STEER)
+		{
+			force += algomath::steer(position, velocity, myConfig.steerPoint, myConfig.steerForce, myConfig.steerMaxForce);
+			force += algomath::arrive(position, velocity, myConfig.arrivePoint, myConfig.arriveForce, myConfig.arriveRange, myConfig.arriveMaxForce);
+		}
+
+		if (GLOBAL_EFFECTS)
+		{
+			force += myConfig.globalForceVector;
+			particles.acceleration.add(idx, myConfig.globalAccelerationVector);
+		}
+
+		// path behaviours read and write the streams directly
+		particles.force.set(idx, force);
+
+		if (FOLLOW_PATH)
+		{
+			if (DIRECT_FOLLOW)
+			{
+				applyDirectPathFollow(dt, idx);
+			}
+			else
+			{
+				applyPathSteering(dt, idx);
+			}
+		}
+	}
+}
+
+/*
+ * @description adds the classic boids forces to every particle in [begin, end): separation pushes away from neighbours
+ * closer than separationRadius, alignment turns toward their average velocity and cohesion pulls toward their centre.
+ * neighbours come from the grid built in beginUpdate, so each particle only looks at the cells around it
+ * @method applyFlocking
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @return {void}
+ */
+void ParticleEmitter::applyFlocking(unsigned int begin, unsigned int end)
+{
+	float separationRadius2 = myConfig.separationRadius * myConfig.separationRadius;
+	float maxForce2 = myConfig.flockMaxForce * myConfig.flockMaxForce;
+	unsigned int maxNeighbours = myConfig.flockMaxNeighbours;
+
+	for (unsigned int idx = begin; idx < end; ++idx)
+	{
+		glm::vec3 position = particles.position.get(idx);
+		glm::vec3 velocity = particles.velocity.get(idx);
+
+		glm::vec3 separation(0.0f);
+		glm::vec3 velocitySum(0.0f);
+		glm::vec3 positionSum(0.0f);
+		unsigned int numNeighbours = 0;
+
+		neighbourGrid.forEachNeighbour(position, myConfig.flockRadius, [&](unsigned int other, const glm::vec3& otherPosition, const glm::vec3& otherVelocity)
+		{
+			if (other == idx)
+			{
+				return true;
+			}
+
+			glm::vec3 away = position - otherPosition;
+			float distance2 = glm::dot(away, away);
+			if (distance2 < separationRadius2 && distance2 > PRETTY_MUCH_ZERO)
+			{
+				separation += away / distance2; // closer neighbours push harder
+			}
+
+			velocitySum += otherVelocity;
+			positionSum += otherPosition;
+			++numNeighbours;
+			return maxNeighbours == 0 || numNeighbours < maxNeighbours;
+		});
+
+		if (numNeighbours == 0)
+		{
+			continue;
+		}
+
+		float inverseCount = 1.0f / numNeighbours;
+		glm::vec3 force = separation * myConfig.separationForce
+			+ (velocitySum * inverseCount - velocity) * myConfig.alignmentForce
+			+ (positionSum * inverseCount - position) * myConfig.cohesionForce;
+
+		float force2 = glm::dot(force, force);
+		if (maxForce2 > 0.0f && force2 > maxForce2)
+		{
+			force *= myConfig.flockMaxForce / sqrt(force2);
+		}
+
+		particles.force.add(idx, force);
+	}
+}
+
+/*
+ * @description loads the vector field. a file that can't be mapped falls back to generated curl noise, so the effect
+ * still does something and the load isn't retried every update
+ * @method loadVectorField
+ * @return {void}
+ */
+void ParticleEmitter::loadVectorField()
+{
+	myState.vectorField = std::make_shared<algomath::VectorField>();
+
+	if (!myState.vectorFieldFile.empty() && myState.vectorField->loadFromFile(myState.vectorFieldFile))
+	{
+		return;
+	}
+
+	myState.vectorField->generateCurlNoise(myConfig.vectorFieldResolution, myConfig.vectorFieldFrequency, myConfig.randomSeed);
+}
+
+/*
+ * @description fills vectorFieldSampler for this update. the map to grid coordinates takes a particle to the field's
+ * unit cube with the inverse of vectorFieldTransform, then scales [-0.5, 0.5] up to [0, size - 1]
+ * @method prepareVectorField
+ * @return {void}
+ */
+void ParticleEmitter::prepareVectorField()
+{
+	if (!myState.vectorField)
+	{
+		loadVectorField();
+	}
+
+	const algomath::VectorField& field = *myState.vectorField;
+	vectorFieldSampler.x = field.dataX();
+	vectorFieldSampler.y = field.dataY();
+	vectorFieldSampler.z = field.dataZ();
+	vectorFieldSampler.size[0] = field.sizeX();
+	vectorFieldSampler.size[1] = field.sizeY();
+	vectorFieldSampler.size[2] = field.sizeZ();
+	vectorFieldSampler.strength = myConfig.vectorFieldStrength;
+	vectorFieldSampler.mode = myConfig.vectorFieldMode;
+
+	myConfig.vectorFieldTransform.update();
+	glm::mat4 toField = glm::inverse(myConfig.vectorFieldTransform.getTransform());
+
+	for (int a = 0; a < 3; ++a)
+	{
+		float scale = (float)(vectorFieldSampler.size[a] - 1);
+		for (int b = 0; b < 3; ++b)
+		{
+			vectorFieldSampler.toGrid[a][b] = toField[b][a] * scale;
+		}
+		vectorFieldSampler.toGrid[a][3] = (toField[3][a] + 0.5f) * scale;
+	}
+}
+
+/*
+ * @description adds the vector field's push to every particle in [begin, end) that is inside it
+ * @method applyVectorField
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @return {void}
+ */
+void ParticleEmitter::applyVectorField(unsigned int begin, unsigned int end)
+{
+	if (vectorFieldSampler.x == nullptr)
+	{
+		return;
+	}
+
+	algomath::VectorFieldStreams streams;
+	streams.posX = particles.position.x.data();
+	streams.posY = particles.position.y.data();
+	streams.posZ = particles.position.z.data();
+	streams.velX = particles.velocity.x.data();
+	streams.velY = particles.velocity.y.data();
+	streams.velZ = particles.velocity.z.data();
+	streams.forceX = particles.force.x.data();
+	streams.forceY = particles.force.y.data();
+	streams.forceZ = particles.force.z.data();
+
+	algomath::applyVectorField(streams, vectorFieldSampler, begin, end);
+}
+
+/*
+ * @description updates the size, colour and speed limit over lifetime of every particle in [begin, end)
+ * @method updateLifetime
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @return {void}
+ */
+template<bool SIZE, bool COLOUR, bool LIMIT_SPEED>
+void ParticleEmitter::updateLifetime(unsigned int begin, unsigned int end)
+{
+	if (!SIZE && !COLOUR && !LIMIT_SPEED)
+	{
+		return;
+	}
+
+	for (unsigned int idx = begin; idx < end; ++idx)
+	{
+		float normalizedLife = algomath::clamp(1.0f - (particles.life[idx] / particles.lifespan[idx]), 0.0f, 1.0f);
+
+		if (SIZE)
+		{
+			float normalizedSize = myState.sizeCurve.lookup(normalizedLife);
+			particles.size[idx] = algomath::lerp(particles.sizeBegin[idx], particles.sizeEnd[idx], normalizedSize);
+		}
+
+		if (COLOUR)
+		{
+			float normalizedColour = myState.colourCurve.lookup(normalizedLife);
+			particles.colour[idx] = algomath::lerp(particles.colourBegin[idx], particles.colourEnd[idx], normalizedColour);
+		}
+
+		if (LIMIT_SPEED)
+		{
+			float normalizedSpeed = myState.speedCurve.lookup(normalizedLife);
+			particles.speedLimit[idx] = algomath::lerp(particles.speedLimitBegin[idx], particles.speedLimitEnd[idx], normalizedSpeed);
+		}
+	}
+}
+
+/*
+ * @description integrates velocity and position for a range of particles using the widest SIMD kernel the cpu supports.
+ * forces and acceleration are reset and life is reduced by dt
+ * @method integrateParticles
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @params {const float&} dt - delta time
+ * @return {void}
+ */
+void ParticleEmitter::integrateParticles(unsigned int begin, unsigned int end, const float& dt)
+{
+	algomath::IntegrationStreams streams;
+	streams.posX = particles.position.x.data();
+	streams.posY = particles.position.y.data();
+	streams.posZ = particles.position.z.data();
+	streams.velX = particles.velocity.x.data();
+	streams.velY = particles.velocity.y.data();
+	streams.velZ = particles.velocity.z.data();
+	streams.accelX = particles.acceleration.x.data();
+	streams.accelY = particles.acceleration.y.data();
+	streams.accelZ = particles.acceleration.z.data();
+	streams.forceX = particles.force.x.data();
+	streams.forceY = particles.force.y.data();
+	streams.forceZ = particles.force.z.data();
+	streams.mass = particles.mass.data();
+	streams.life = particles.life.data();
+	streams.speedLimit = (kernels.flags & UPDATE_LIMIT_SPEED) ? particles.speedLimit.data() : nullptr;
+	streams.bounds = chunkBoundsFor(begin);
+
+	algomath::integrateParticles(streams, begin, end, dt);
+}
+
+/*
+ * @description pushes particles in [begin, end) back out of every collider they went into. colliders that kill
+ * only zero life, endUpdate removes the particles with everything else that died
+ * @method collideParticles
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @return {void}
+ */
+void ParticleEmitter::collideParticles(unsigned int begin, unsigned int end)
+{
+	if (colliderShapes.empty())
+	{
+		return;
+	}
+
+	algomath::CollisionStreams streams;
+	streams.posX = particles.position.x.data();
+	streams.posY = particles.position.y.data();
+	streams.posZ = particles.position.z.data();
+	streams.velX = particles.velocity.x.data();
+	streams.velY = particles.velocity.y.data();
+	streams.velZ = particles.velocity.z.data();
+	streams.life = particles.life.data();
+
+	for (const algomath::ColliderShape& collider : colliderShapes)
+	{
+		algomath::collideParticles(streams, collider, begin, end);
+	}
+}
+
+/*
+ * @description reports particles whose position has become NaN. does nothing outside of debug builds
+ * @method checkParticles
+ * @params {unsigned int} begin - first particle index
+ * @params {unsigned int} end - one past the last particle index
+ * @return {void}
+ */
+void ParticleEmitter::checkParticles(unsigned int begin, unsigned int end)
+{
+#ifdef _DEBUG
+	for (unsigned int idx = begin; idx < end; ++idx)
+	{
+		if (isnan(particles.position.x[idx]))
+		{
+			printf("NaN at particle %u ", idx);
+
+			if (isnan(particles.velocity.x[idx]))
+			{
+				printf("vel! ");
+			}
+
+			printf("pos! mass: %f, life: %f, lifespan: %f\n", particles.mass[idx], particles.life[idx], particles.lifespan[idx]);
+		}
+	}
+#endif
+}
+
+/*
+ * @description radius of the biggest particle Config can make, for padding bounds
+ * @method maxParticleRadius
+ * @return {float}
+ */
+float ParticleEmitter::maxParticleRadius() const
+{
+	float size = glm::max(glm::max(myConfig.sizeRangeBegin.x, myConfig.sizeRangeBegin.y), glm::max(myConfig.sizeRangeEnd.x, myConfig.sizeRangeEnd.y));
+	return size * (myState.particleMesh ? PARTICLE_MESH_RADIUS : PARTICLE_SPHERE_RADIUS);
+}
+
+/*
+ * @description world space box around everything the emitter draws. localBounds when there are particles, padded by the
+ * particle size and moved into world space, otherwise what Config says the emitter would fill
+ * @method getBounds
+ * @return {ParticleBounds} empty if there are no particles and the emitter isn't playing
+ */
+ParticleBounds ParticleEmitter::getBounds() const
+{
+	if (particles.numAlive() == 0)
+	{
+		return myConfig.playing ? estimateBounds() : ParticleBounds();
+	}
+
+	ParticleBounds box = localBounds;
+	box.expand(maxParticleRadius());
+	return myConfig.parentTransforms ? box.transformed(worldMatrix) : box;
+}
+
+/*
+ * @description where particles could get to from Config alone: the emission shape, grown by the farthest a particle can
+ * travel in its life at its starting speed under the uniform effects. behaviours that steer particles aren't accounted
+ * for, so this is for placing idle emitters, not for culling live particles
+ * @method estimateBounds
+ * @return {ParticleBounds} in world space
+ */
+ParticleBounds ParticleEmitter::estimateBounds() const
+{
+	ParticleBounds box;
+	switch (myConfig.emissionShape)
+	{
+	case CUBOID:
+		box.add(myConfig.boxSize * -0.5f);
+		box.add(myConfig.boxSize * 0.5f);
+		break;
+	case FRUSTUM:
+	{
+		float radius = glm::max(myConfig.frustumRadiusSpawn, myConfig.frustumRadiusTarget);
+		box.add(glm::vec3(-radius, 0.0f, -radius));
+		box.add(glm::vec3(radius, myConfig.frustumHeight, radius));
+		break;
+	}
+	default:
+	case SPHERE:
+		box.add(glm::vec3(-myConfig.sphereRadius));
+		box.add(glm::vec3(myConfig.sphereRadius));
+		break;
+	}
+	box.min += myConfig.emitterOffset;
+	box.max += myConfig.emitterOffset;
+
+	float life = glm::max(myConfig.lifeRange.x, myConfig.lifeRange.y);
+	float speed = glm::max(glm::abs(myConfig.initialSpeedRange.x), glm::abs(myConfig.initialSpeedRange.y));
+	float acceleration = 0.0f;
+	if (myConfig.globalEffects)
+	{
+		float minMass = glm::max(glm::min(myConfig.massRange.x, myConfig.massRange.y), 0.001f);
+		acceleration = glm::length(myConfig.globalAccelerationVector) + glm::length(myConfig.globalForceVector) / minMass;
+	}
+	float reach = speed * life + 0.5f * acceleration * life * life + maxParticleRadius();
+
+	// relative particles are scaled by worldMatrix with everything else, world space ones only start out in it
+	if (myConfig.parentTransforms)
+	{
+		box.expand(reach);
+		return box.transformed(worldMatrix);
+	}
+	box = box.transformed(worldMatrix);
+	box.expand(reach);
+	return box;
+}
+
+/*
+ * @description adds the box each analytic particle in [begin, end) stays inside for the rest of its life to box. on
+ * each axis the closed form is a parabola, so its extremes are at the ends of the flight or where that axis's
+ * velocity turns around. the flight starts a step early, since render draws up to a step behind
+ * @method addFlightBounds
+ * @params {unsigned int} begin
+ * @params {unsigned int} end
+ * @params {ParticleBounds&} box
+ * @return {void}
+ */
+void ParticleEmitter::addFlightBounds(unsigned int begin, unsigned int end, ParticleBounds& box) const
+{
+	for (unsigned int idx = begin; idx < end; ++idx)
+	{
+		float from = glm::max(particleAge(idx) - updateDt, 0.0f);
+		float to = particles.lifespan[idx];
+		box.add(evaluatePosition(idx, from));
+		box.add(evaluatePosition(idx, to));
+
+		glm::vec3 acceleration = analyticMotion.acceleration + analyticMotion.force / particles.mass[idx];
+		glm::vec3 velocity = particles.velocity.get(idx);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (acceleration[axis] != 0.0f)
+			{
+				float turn = -velocity[axis] / acceleration[axis];
+				if (turn > from && turn < to)
+				{
+					box.add(evaluatePosition(idx, turn));
+				}
+			}
+		}
+	}
+}
+
+/*
+ * @description measures localBounds again from every live particle, from where they were and are for integrated
+ * particles, or from their flights for analytic ones
+ * @method rebuildBounds
+ * @return {void}
+ */
+void ParticleEmitter::rebuildBounds()
+{
+	localBounds = ParticleBounds();
+	unsigned int numAlive = particles.numAlive();
+	if (analyticMotion.active)
+	{
+		addFlightBounds(0, numAlive, localBounds);
+		boundsRebuildCountdown = PARTICLE_BOUNDS_REBUILD_STEPS;
+		return;
+	}
+
+	float bounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	algomath::boundParticles(particles.position.x.data(), particles.position.y.data(), particles.position.z.data(), 0, numAlive, bounds);
+	algomath::boundParticles(particles.previousPosition.x.data(), particles.previousPosition.y.data(), particles.previousPosition.z.data(), 0, numAlive, bounds);
+	localBounds.add(glm::vec3(bounds[0], bounds[1], bounds[2]));
+	localBounds.add(glm::vec3(bounds[3], bounds[4], bounds[5]));
+}
+
+/*
+ * @description sets up the culling pass for view. the frustum planes are moved into the particles' space, so particles
+ * are tested where they are stored, without transforming each one first
+ * @method makeCullView
+ * @params {const ParticleRenderView&} view
+ * @params {ParticleFrustum} frustum - of view, in world space
+ * @params {float} interpolation
+ * @params {algomath::CullView&} cullView
+ * @return {void}
+ */
+void ParticleEmitter::makeCullView(const ParticleRenderView& view, ParticleFrustum frustum, float interpolation, algomath::CullView& cullView) const
+{
+	float radius = myState.particleMesh ? PARTICLE_MESH_RADIUS : PARTICLE_SPHERE_RADIUS;
+	if (myConfig.parentTransforms)
+	{
+		// a world space plane p is p * worldMatrix in local space, and still measures world space distances.
+		// particle sizes are local, so the radius is scaled by the matrix's largest axis
+		float scale = glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::max(glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))));
+		radius *= scale;
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane = plane * worldMatrix;
+		}
+	}
+
+	for (int p = 0; p < 6; ++p)
+	{
+		cullView.planes[p][0] = frustum.planes[p].x;
+		cullView.planes[p][1] = frustum.planes[p].y;
+		cullView.planes[p][2] = frustum.planes[p].z;
+		cullView.planes[p][3] = frustum.planes[p].w;
+	}
+	cullView.interpolation = interpolation;
+	cullView.radiusScale = radius;
+	// a sphere of radius r at distance d covers r * projection[1][1] / d of the screen's height
+	cullView.sizeFactor = view.minScreenSize > 0.0f ? view.projectionMatrix[1][1] / view.minScreenSize : 0.0f;
+}
+
+/*
+ * @description adds the emitter's live particles to the draw list. an emitter whose bounds are off screen is culled
+ * whole. otherwise particles outside the view's frustum, or smaller on screen than view.minScreenSize, are culled
+ * first, so they never get a matrix or an instance
+ * @method render
+ * @params {const ParticleRenderView&} view - camera the frame is drawn from
+ * @params {float} interpolation - where to draw particles between their previous (0) and current (1) positions
+ * @params {ParticleDrawList&} drawList
+ * @return {void}
+ */
+void ParticleEmitter::render(const ParticleRenderView& view, float interpolation, ParticleDrawList& drawList) const
+{
+	lastDrawn = 0;
+	lastCulled = 0;
+
+	unsigned int numAlive = particles.numAlive();
+	if (numAlive == 0)
+	{
+		return;
+	}
+
+	algomath::CullView cullView;
+	bool cull = view.cullParticles;
+	if (cull)
+	{
+		ParticleFrustum frustum(view);
+		if (!frustum.intersectsBox(getBounds()))
+		{
+			lastCulled = numAlive;
+			drawList.addCulled(numAlive);
+			return;
+		}
+		makeCullView(view, frustum, interpolation, cullView);
+	}
+
+	if (analyticMotion.active)
+	{
+		renderAnalytic(cull ? &cullView : nullptr, interpolation, drawList);
+		return;
+	}
+
+	unsigned int numVisible = numAlive;
+	if (cull)
+	{
+		cullVisible.resize(numAlive);
+		algomath::CullStreams streams = {
+			particles.position.x.data(), particles.position.y.data(), particles.position.z.data(),
+			particles.previousPosition.x.data(), particles.previousPosition.y.data(), particles.previousPosition.z.data(),
+			particles.size.data()
+		};
+		numVisible = algomath::cullParticles(streams, cullView, 0, numAlive, cullVisible.data());
+	}
+
+	lastDrawn = numVisible;
+	lastCulled = numAlive - numVisible;
+	drawList.addCulled(lastCulled);
+	if (numVisible == 0)
+	{
+		return;
+	}
+
+	ParticleInstance* instances = drawList.append(myState.particleMesh.get(), numVisible);
+
+	// particles never rotate, so the matrix is just a uniform scale and a translation.
+	// it is built here rather than stored, so only particles that actually get drawn pay for it
+	glm::mat4 particleMatrix(1.0f);
+
+	for (unsigned int n = 0; n < numVisible; ++n)
+	{
+		unsigned int i = cull ? cullVisible[n] : n;
+		float size = particles.size[i];
+		particleMatrix[0][0] = size;
+		particleMatrix[1][1] = size;
+		particleMatrix[2][2] = size;
+		particleMatrix[3] = glm::vec4(glm::mix(particles.previousPosition.get(i), particles.position.get(i), interpolation), 1.0f);
+
+		instances[n].matrix = myConfig.parentTransforms ? worldMatrix * particleMatrix : particleMatrix;
+		instances[n].colour = particles.colour[i];
+	}
+}
+
+/*
+ * @description render for analytic motion. every particle is evaluated at its age as of the interpolated time, lifetime
+ * graphs included, so updates never have to touch anything but life. positions and sizes are evaluated for everything
+ * to cull with, colours only for what is drawn
+ * @method renderAnalytic
+ * @params {const algomath::CullView *} cullView - from makeCullView, nullptr to draw everything
+ * @params {float} interpolation - where to draw particles between the previous (0) and current (1) step
+ * @params {ParticleDrawList&} drawList
+ * @return {void}
+ */
+void ParticleEmitter::renderAnalytic(const algomath::CullView* cullView, float interpolation, ParticleDrawList& drawList) const
+{
+	unsigned int numAlive = particles.numAlive();
+	float stepBack = (1.0f - interpolation) * updateDt;
+	bool sizeOverLifetime = (kernels.flags & UPDATE_SIZE_OVER_LIFETIME) != 0;
+	bool colourOverLifetime = (kernels.flags & UPDATE_COLOUR_OVER_LIFETIME) != 0;
+
+	analyticPosition.x.resize(numAlive);
+	analyticPosition.y.resize(numAlive);
+	analyticPosition.z.resize(numAlive);
+	analyticSize.resize(numAlive);
+
+	for (unsigned int i = 0; i < numAlive; ++i)
+	{
+		float age = glm::max(particleAge(i) - stepBack, 0.0f);
+		analyticPosition.set(i, evaluatePosition(i, age));
+		analyticSize[i] = sizeOverLifetime
+			? algomath::lerp(particles.sizeBegin[i], particles.sizeEnd[i], myState.sizeCurve.lookup(algomath::clamp(age / particles.lifespan[i], 0.0f, 1.0f)))
+			: particles.size[i];
+	}
+
+	bool cull = cullView != nullptr;
+	unsigned int numVisible = numAlive;
+	if (cull)
+	{
+		// positions are already interpolated, so they are their own previous positions
+		cullVisible.resize(numAlive);
+		algomath::CullStreams streams = {
+			analyticPosition.x.data(), analyticPosition.y.data(), analyticPosition.z.data(),
+			analyticPosition.x.data(), analyticPosition.y.data(), analyticPosition.z.data(),
+			analyticSize.data()
+		};
+		numVisible = algomath::cullParticles(streams, *cullView, 0, numAlive, cullVisible.data());
+	}
+
+	lastDrawn = numVisible;
+	lastCulled = numAlive - numVisible;
+	drawList.addCulled(lastCulled);
+	if (numVisible == 0)
+	{
+		return;
+	}
+
+	ParticleInstance* instances = drawList.append(myState.particleMesh.get(), numVisible);
+	glm::mat4 particleMatrix(1.0f);
+
+	for (unsigned int n = 0; n < numVisible; ++n)
+	{
+		unsigned int i = cull ? cullVisible[n] : n;
+		float size = analyticSize[i];
+		particleMatrix[0][0] = size;
+		particleMatrix[1][1] = size;
+		particleMatrix[2][2] = size;
+		particleMatrix[3] = glm::vec4(analyticPosition.get(i), 1.0f);
+
+		instances[n].matrix = myConfig.parentTransforms ? worldMatrix * particleMatrix : particleMatrix;
+		if (colourOverLifetime)
+		{
+			float age = glm::max(particleAge(i) - stepBack, 0.0f);
+			float normalizedLife = algomath::clamp(age / particles.lifespan[i], 0.0f, 1.0f);
+			instances[n].colour = algomath::lerp(particles.colourBegin[i], particles.colourEnd[i], myState.colourCurve.lookup(normalizedLife));
+		}
+		else
+		{
+			instances[n].colour = particles.colour[i];
+		}
+	}
+}
+
+/*
+ * @description this method spawns each particle according to paramater options assigned
+ * @method spawnParticle
+ * @params {unsigned int} idx - index of the particle
+ * @params {const float *} randoms - PARTICLE_SPAWN_RANDOMS uniforms in [0, 1). 0-3 properties, 4-8 emission shape, 9-11 speeds
+ * @return {void}
+ */
+inline void ParticleEmitter::spawnParticle(unsigned int idx, const float* randoms)
+{
+	particles.colourBegin[idx] = algomath::lerp(myConfig.colourBegin0, myConfig.colourBegin1, randoms[0]);
+	particles.colourEnd[idx] = algomath::lerp(myConfig.colourEnd0, myConfig.colourEnd1, randoms[1]);
+
+	particles.lifespan[idx] = algomath::lerp(myConfig.lifeRange.x, myConfig.lifeRange.y, randoms[2]);
+	particles.life[idx] = particles.lifespan[idx];
+
+	float randomTval_A = randoms[3];
+	//couple mass and size relationship
+	particles.mass[idx] = algomath::lerp(myConfig.massRange.x, myConfig.massRange.y, randomTval_A);
+	particles.sizeBegin[idx] = algomath::lerp(myConfig.sizeRangeBegin.x, myConfig.sizeRangeBegin.y, randomTval_A);
+	particles.sizeEnd[idx] = algomath::lerp(myConfig.sizeRangeEnd.x, myConfig.sizeRangeEnd.y, randomTval_A);
+
+	//emission shapes determine initial velocity and position distribution
+	switch (myConfig.emissionShape)
+	{
+	case CUBOID:
+	{
+		emitFromCuboid(idx, randoms + 4);
+		break;
+	}
+	case FRUSTUM:
+	{
+		emitFromFrustum(idx, randoms + 4);
+		break;
+	}
+	default:
+	case SPHERE:
+	{
+		emitFromSphere(idx, randoms + 4);
+		break;
+	}
+	}
+	//emit functions will set a position and a normalized velocity 
+
+	float startspeed = algomath::lerp(myConfig.initialSpeedRange.x, myConfig.initialSpeedRange.y, randoms[9]);
+	glm::vec3 velocity = particles.velocity.get(idx) * startspeed;
+	glm::vec3 position = particles.position.get(idx) + myConfig.emitterOffset;
+
+	particles.speedLimitBegin[idx] = algomath::lerp(myConfig.initialSpeedLimitRange.x, myConfig.initialSpeedLimitRange.y, randoms[10]);
+	particles.speedLimitEnd[idx] = algomath::lerp(myConfig.finalSpeedLimitRange.x, myConfig.finalSpeedLimitRange.y, randoms[11]);
+
+	particles.distanceTravelledAlongPath[idx] = 0.0f;
+	particles.pathCursor[idx] = algomath::PathCursor();
+	particles.lookAheadCursor[idx] = algomath::PathCursor();
+
+	if (!myConfig.parentTransforms)
+	{
+		velocity = glm::vec3(myConfig.transform.getRotationMatrix() * glm::vec4(velocity, 1.0f));
+		position = glm::vec3(worldMatrix * glm::vec4(position, 1.0f));
+	}
+
+	particles.position.set(idx, position);
+	particles.previousPosition.set(idx, position);
+	particles.velocity.set(idx, velocity);
+	particles.force.set(idx, glm::vec3(0.0f));
+	particles.acceleration.set(idx, glm::vec3(0.0f));
+
+	particles.size[idx] = particles.sizeBegin[idx];
+	particles.colour[idx] = particles.colourBegin[idx];
+}
+
+/*
+ * @description this method applies steering behaviour to each particle
+ * @method applyPathSteering
+ * @params {const float&} dt - deltaTime
+ * @params {unsigned int} idx - index of the particle
+ * @return {void}
+ */
+void ParticleEmitter::applyPathSteering(const float& dt, unsigned int idx)
+{
+	float& distanceTravelledAlongPath = particles.distanceTravelledAlongPath[idx];
+	distanceTravelledAlongPath = fmod(distanceTravelledAlongPath, myState.path.getLength());
+	size_t numIntervals = myState.path.numIntervals();
+	// find interval. particles only move a little each update, so the cursor is usually already there or one entry behind
+	algomath::PathCursor& cursor = particles.pathCursor[idx];
+	myState.path.advanceCursor(cursor, distanceTravelledAlongPath);
+	unsigned int interval = cursor.interval;
+	algomath::Path<glm::vec3>::const_iterator current = myState.path.cursorEntry(cursor);
+	algomath::Path<glm::vec3>::const_iterator next = std::next(current);
+
+	glm::vec3 proj;
+	glm::vec3 pathVec; // the current segment for the path
+	glm::vec3 position = particles.position.get(idx);
+	glm::vec3 velocity = particles.velocity.get(idx);
+	glm::vec3 futurePosition = position + (velocity *  dt);
+	glm::vec3 pathTarget;
+
+	if (next != myState.path.intervalEnd(interval))
+	{
+		pathVec = next->val - current->val;
+		proj = glm::proj(futurePosition - current->val, pathVec);
+	}
+	else
+	{
+		if (interval == numIntervals - 1u)
+		{
+			pathVec = current->val - std::prev(current)->val;
+			float scalarProj = algomath::scalarProj(futurePosition, pathVec);
+			proj = pathVec * scalarProj;
+			if (isnan(proj.x))
+			{
+				proj = glm::vec3(0.0f);
+			}
+		}
+		else
+		{
+			// line to next interval
+			pathVec = std::next(myState.path.intervalBegin(interval + 1u))->val - current->val;
+			proj = glm::proj(futurePosition - current->val, pathVec);
+		}
+	}
+
+
+	if (glm::length2(proj + current->val - futurePosition) > (myConfig.pathRadius * myConfig.pathRadius)) // if distance to the path is greater than a threshold
+	{
+		pathTarget = myState.path.lookupValue(fmod((distanceTravelledAlongPath + myConfig.lookAhead), myState.path.getLength()), particles.lookAheadCursor[idx]);
+		particles.force.add(idx, algomath::steer(position, velocity, pathTarget, myConfig.pathPower, myConfig.pathPower));
 	}
 
 	float distanceAlongInterval = glm::length(proj);
-	particle->distanceTravelledAlongPath = current->distanceAlongPath + distanceAlongInterval;
+	distanceTravelledAlongPath = current->distanceAlongPath + distanceAlongInterval;
 }
 
 /*
 * @description this method applies direct path follow behaviour for each particle
 * @method applyPathSteering
 * @params {const float&} dt - deltaTime
-* @params {Particle *} particle - a pointer to each particle
+* @params {unsigned int} idx - index of the particle
 * @return {void}
 */
-void ParticleEmitter::applyDirectPathFollow(const float& dt, Particle* particle)
+void ParticleEmitter::applyDirectPathFollow(const float& dt, unsigned int idx)
 {
-	particle->distanceTravelledAlongPath = fmod(particle->distanceTravelledAlongPath, myState.path.getLength());
+	float& distanceTravelledAlongPath = particles.distanceTravelledAlongPath[idx];
+	distanceTravelledAlongPath = fmod(distanceTravelledAlongPath, myState.path.getLength());
 	float distanceToTravel = myConfig.pathPower * dt;
 
-	glm::vec3 pathTarget = myState.path.lookupValue(particle->distanceTravelledAlongPath + distanceToTravel);
-	particle->transform.setPosition(pathTarget);
+	glm::vec3 pathTarget = myState.path.lookupValue(distanceTravelledAlongPath + distanceToTravel, particles.pathCursor[idx]);
+	particles.position.set(idx, pathTarget);
 
-	particle->distanceTravelledAlongPath += distanceToTravel;
+	distanceTravelledAlongPath += distanceToTravel;
 }
 
 /* 
@@ -910,37 +2137,177 @@ void ParticleEmitter::applyDirectPathFollow(const float& dt, Particle* particle)
  */
 glm::vec3 ParticleEmitter::getParticlePosition(unsigned int idx)
 {
-	if (idx >= myConfig.numberOfParticles)
+	if (idx >= particles.numAlive())
 	{
 		std::cout << "ParticleEmitter::getParticlePosition ERROR: idx " << idx << "out of range!" << std::endl;
 		return glm::vec3();
 	}
-	return particles[idx].transform.getPosition();
+	if (analyticMotion.active)
+	{
+		return evaluatePosition(idx, particleAge(idx));
+	}
+	return particles.position.get(idx);
+}
+
+namespace
+{
+	// the emitter's own part of a timeline checkpoint, the particle pool follows it
+	struct EmitterState
+	{
+		float emissionTime;
+		float timeRemaining;
+		float updateDt;
+		uint64_t spawnSerial; // with the seed in Config, all there is to the random state
+		glm::vec3 rotation;
+		bool analytic;
+		glm::vec3 analyticAcceleration;
+		glm::vec3 analyticForce;
+		unsigned int lodLevel;
+		float lodDt;
+		unsigned int lodStepsPending;
+		unsigned int lodLastUpdateSteps;
+		unsigned int budgetQuota;
+		float budgetEmissionScale;
+		unsigned int budgetLodBias;
+	};
+}
+
+/*
+ * @description bytes saveState writes
+ * @method stateSize
+ * @return {size_t}
+ */
+size_t ParticleEmitter::stateSize() const
+{
+	return sizeof(EmitterState) + particles.stateSize();
+}
+
+/*
+ * @description bytes a state written by saveState takes. that depends on the capacity it was saved with, which may not
+ * be the current one
+ * @method stateSize
+ * @params {const uint8_t *} state
+ * @params {size_t} available - bytes readable at state
+ * @return {size_t} 0 if available is too short to hold the capacity
+ */
+size_t ParticleEmitter::stateSize(const uint8_t* state, size_t available) const
+{
+	if (available < sizeof(EmitterState) + sizeof(unsigned int))
+	{
+		return 0;
+	}
+	return sizeof(EmitterState) + particles.stateSize(ParticlePool::savedCapacity(state + sizeof(EmitterState)));
+}
+
+/*
+ * @description saves the emitter's simulation state. event buffers are empty between steps, so they aren't saved
+ * @method saveState
+ * @params {uint8_t *} out - stateSize bytes
+ * @return {void}
+ */
+void ParticleEmitter::saveState(uint8_t* out) const
+{
+	EmitterState state;
+	memset(&state, 0, sizeof(state)); // padding too, so identical states compare equal byte for byte
+	state.emissionTime = emissionTime;
+	state.timeRemaining = timeRemaining;
+	state.updateDt = updateDt;
+	state.spawnSerial = spawnSerial;
+	state.rotation = myConfig.transform.getRotation();
+	state.analytic = analyticMotion.active;
+	state.analyticAcceleration = analyticMotion.acceleration;
+	state.analyticForce = analyticMotion.force;
+	state.lodLevel = lodLevel;
+	state.lodDt = lodDt;
+	state.lodStepsPending = lodStepsPending;
+	state.lodLastUpdateSteps = lodLastUpdateSteps;
+	state.budgetQuota = budgetQuota;
+	state.budgetEmissionScale = budgetEmissionScale;
+	state.budgetLodBias = budgetLodBias;
+
+	memcpy(out, &state, sizeof(state));
+	particles.saveState(out + sizeof(state));
+}
+
+/*
+ * @description restores a state written by saveState
+ * @method loadState
+ * @params {const uint8_t *} in
+ * @return {void}
+ */
+void ParticleEmitter::loadState(const uint8_t* in)
+{
+	EmitterState state;
+	memcpy(&state, in, sizeof(state));
+	emissionTime = state.emissionTime;
+	timeRemaining = state.timeRemaining;
+	updateDt = state.updateDt;
+	spawnSerial = state.spawnSerial;
+	myConfig.transform.setRotation(state.rotation);
+	myConfig.transform.update();
+	analyticMotion.active = state.analytic;
+	analyticMotion.acceleration = state.analyticAcceleration;
+	analyticMotion.force = state.analyticForce;
+	lodLevel = state.lodLevel;
+	lodDt = state.lodDt;
+	lodStepsPending = state.lodStepsPending;
+	lodLastUpdateSteps = state.lodLastUpdateSteps;
+	budgetQuota = state.budgetQuota;
+	budgetEmissionScale = state.budgetEmissionScale;
+	budgetLodBias = state.budgetLodBias;
+
+	particles.loadState(in + sizeof(state));
+	myConfig.numberOfParticles = particles.capacity();
+	birthEvents.clear();
+	deathEvents.clear();
+	rebuildBounds();
 }
 
 /*
- * @description this method sets the number of particles in the particle system
+ * @description sets how many particles can be alive at once. the running effect carries on: living particles are kept,
+ * except those in slots past a smaller capacity, and the pool only reallocates now and then
  * @method setNumParticles
  * @params {unsigned int} numParticles
  * @return {void}
  */
 void ParticleEmitter::setNumParticles(unsigned int numParticles) 
 {
-	freeMemory(); // destroy any existing particles
+	particles.setCapacity(numParticles);
+	myConfig.numberOfParticles = numParticles;
+}
 
-	if (numParticles > 0)
-	{
-		particles = new Particle[numParticles];
-		myConfig.numberOfParticles = numParticles;
+/*
+ * @description the steady state particle count, emissionRate particles a second each living up to lifeRange.y, with
+ * some headroom
+ * @method autoCapacity
+ * @return {unsigned int}
+ */
+unsigned int ParticleEmitter::autoCapacity() const
+{
+	float steadyState = myConfig.emissionRate * glm::max(myConfig.lifeRange.x, myConfig.lifeRange.y) * PARTICLE_AUTO_CAPACITY_HEADROOM;
+	return (unsigned int)glm::clamp(std::ceil(steadyState), 0.0f, (float)PARTICLE_AUTO_CAPACITY_MAX);
+}
 
-		Particle* particle = particles;
-		for (unsigned int i = 0; i < myConfig.numberOfParticles; ++i, ++particle)
-		{
-			particle->mesh = myState.meshes["hexagon"];
-		}
-	}
+/*
+ * @description sets the seed particles draw their random properties from and restarts the random sequence
+ * @method setRandomSeed
+ * @params {unsigned int} seed
+ * @return {void}
+ */
+void ParticleEmitter::setRandomSeed(unsigned int seed)
+{
+	myConfig.randomSeed = seed;
+	restartRandom();
+}
 
-	
+/*
+ * @description the next particle spawned gets the first random stream again, so the emission replays exactly
+ * @method restartRandom
+ * @return {void}
+ */
+void ParticleEmitter::restartRandom()
+{
+	spawnSerial = 0;
 }
 
 /*
@@ -984,8 +2351,11 @@ void ParticleEmitter::setSizeRangeEnd(float min, float max) {
  * @description this is the empty / default constructor for the ParticleSystem class
  * @constructor
  */
+std::vector<ParticleSystem*> ParticleSystem::s_systems;
+
 ParticleSystem::ParticleSystem()
 {
+	s_systems.push_back(this);
 }
 
 /*
@@ -994,21 +2364,404 @@ ParticleSystem::ParticleSystem()
  */
 ParticleSystem::~ParticleSystem()
 {
+	auto it = std::find(s_systems.begin(), s_systems.end(), this);
+	if (it != s_systems.end())
+	{
+		s_systems.erase(it);
+	}
 	clearSystem();
 }
 
 /*
-* @description this is the update method for the ParticleSystem class
+* @description Component update. only simulates, drawing is left to render so it can be batched with other systems
 * @method update
 * @return {void}
 */
 void ParticleSystem::update()
+{
+	simulate(m_frameTime);
+}
+
+/*
+* @description simulates frameTime seconds. the clock turns it into fixed steps, so effects play the same at any frame rate
+* @method simulate
+* @params {float} frameTime - seconds since the last call
+* @return {void}
+*/
+void ParticleSystem::simulate(float frameTime)
+{
+	double start = algomath::timeMilliseconds();
+
+	unsigned int numSteps = clock.advance(frameTime);
+	for (unsigned int i = 0; i < numSteps; ++i)
+	{
+		step(clock.getFixedStep());
+	}
+
+	// what this frame cost, for ParticleBudget
+	budget.simulateMs = (float)(algomath::timeMilliseconds() - start);
+	budget.averageMs += (budget.simulateMs - budget.averageMs) * PARTICLE_BUDGET_SMOOTHING;
+	budget.particlesAlive = 0;
+	budget.capacity = 0;
+	for (auto emitter : m_emitters)
+	{
+		budget.particlesAlive += emitter->getNumAliveParticles();
+		budget.capacity += emitter->particles.capacity();
+		budget.spawnsDenied += emitter->budgetDenied;
+		emitter->budgetDenied = 0;
+	}
+}
+
+/*
+* @description hands the budget's decisions to the emitters. the quota is shared out by pool size
+* @method applyBudget
+* @return {void}
+*/
+void ParticleSystem::applyBudget()
+{
+	float emissionScale = budget.emissionScale();
+	unsigned int lodBias = budget.lodBias(PARTICLE_LOD_LEVELS);
+
+	for (auto emitter : m_emitters)
+	{
+		emitter->budgetEmissionScale = emissionScale;
+		emitter->budgetLodBias = lodBias;
+		emitter->budgetQuota = ~0u;
+		if (budget.particleQuota != ~0u && budget.capacity > 0)
+		{
+			emitter->budgetQuota = (unsigned int)((uint64_t)budget.particleQuota * emitter->particles.capacity() / budget.capacity);
+		}
+	}
+}
+
+/*
+* @description balances the budget across every particle system that exists
+* @method balanceBudget
+* @params {float} frameTime - seconds since the last balance
+* @return {void}
+*/
+void ParticleSystem::balanceBudget(float frameTime)
+{
+	ParticleBudget::global().balance(s_systems, frameTime);
+}
+
+/*
+* @description adds every emitter's particles to drawList, interpolated between the last two steps
+* @method render
+* @params {const ParticleRenderView&} view
+* @params {ParticleDrawList&} drawList
+* @return {void}
+*/
+void ParticleSystem::render(const ParticleRenderView& view, ParticleDrawList& drawList)
+{
+	float interpolation = clock.getInterpolation();
+	for (auto emitter : m_emitters)
+	{
+		emitter->render(view, emitter->lodInterpolation(interpolation), drawList);
+	}
+}
+
+/*
+* @description the box around every emitter's bounds, for culling the whole system or placing it in a spatial index
+* @method getBounds
+* @return {ParticleBounds} in world space
+*/
+ParticleBounds ParticleSystem::getBounds() const
+{
+	ParticleBounds bounds;
+	for (auto emitter : m_emitters)
+	{
+		bounds.add(emitter->getBounds());
+	}
+	return bounds;
+}
+
+/*
+* @description picks the level of detail of every emitter for view
+* @method selectLod
+* @params {const ParticleRenderView&} view
+* @return {void}
+*/
+void ParticleSystem::selectLod(const ParticleRenderView& view)
+{
+	for (auto emitter : m_emitters)
+	{
+		emitter->selectLod(view);
+	}
+}
+
+/*
+* @description selectLod for every particle system that exists
+* @method selectLodAll
+* @params {const ParticleRenderView&} view
+* @return {void}
+*/
+void ParticleSystem::selectLodAll(const ParticleRenderView& view)
+{
+	for (auto system : s_systems)
+	{
+		system->selectLod(view);
+	}
+}
+
+/*
+* @description renders every particle system that exists into one draw list
+* @method renderAll
+* @params {const ParticleRenderView&} view
+* @params {ParticleDrawList&} drawList
+* @return {void}
+*/
+void ParticleSystem::renderAll(const ParticleRenderView& view, ParticleDrawList& drawList)
+{
+	for (auto system : s_systems)
+	{
+		system->render(view, drawList);
+	}
+}
+
+/*
+* @description advances every emitter by one fixed step
+* @method step
+* @params {float} dt - the fixed step length
+* @return {void}
+*/
+void ParticleSystem::step(float dt)
+{
+	if (!m_seeking && timeline.wantsCheckpoint(m_step))
+	{
+		saveState(m_timelineState);
+		timeline.record(m_step, m_timelineState);
+	}
+
+	glm::mat4 systemMatrix = parent->transformable->getTransform();
+	for (auto emitter : m_emitters)
+	{
+		emitter->worldMatrix = systemMatrix * emitter->myConfig.transform.getTransform();
+	}
+
+	// every chunk of every emitter goes into one job list, so a single huge emitter spreads over all cores just like many small ones.
+	// emitters only share their meshes, which the update never touches
+	m_updateJobs.clear();
+	for (size_t e = 0; e < m_emitters.size(); ++e)
+	{
+		ParticleEmitter* emitter = m_emitters[e];
+		float sliceDt = emitter->sliceStep(dt, m_step + e);
+		if (sliceDt <= 0.0f)
+		{
+			continue;
+		}
+
+		unsigned int numChunks = emitter->beginUpdate(sliceDt);
+		for (unsigned int chunk = 0; chunk < numChunks; ++chunk)
+		{
+			m_updateJobs.push_back(std::make_pair(emitter, chunk));
+		}
+	}
+
+	ThreadPool::global().parallelFor((unsigned int)m_updateJobs.size(), [this](unsigned int i)
+	{
+		m_updateJobs[i].first->updateChunk(m_updateJobs[i].second);
+	});
+
+	for (auto emitter : m_emitters)
+	{
+		emitter->endUpdate();
+	}
+
+	dispatchEvents();
+	++m_step;
+}
+
+/*
+* @description fast forwards every emitter together, in steps of the smallest prewarmStep of any of them
+* @method prewarm
+* @params {float} seconds
+* @return {float} milliseconds it took
+*/
+float ParticleSystem::prewarm(float seconds)
+{
+	double start = algomath::timeMilliseconds();
+	unsigned int numSteps = prewarmSteps(seconds);
+	float dt = (numSteps > 0) ? seconds / numSteps : 0.0f;
+
+	for (auto emitter : m_emitters)
+	{
+		emitter->prewarming = true;
+	}
+	for (unsigned int i = 0; i < numSteps; ++i)
+	{
+		step(dt);
+	}
+	for (auto emitter : m_emitters)
+	{
+		emitter->prewarming = false;
+	}
+	clock.reset();
+
+	// prewarm steps aren't fixed steps, so the prewarmed state becomes time zero of the timeline
+	timeline.clear();
+	m_step = 0;
+
+	return (float)(algomath::timeMilliseconds() - start);
+}
+
+/*
+* @description how many equal steps prewarm splits seconds into
+* @method prewarmSteps
+* @params {float} seconds
+* @return {unsigned int}
+*/
+unsigned int ParticleSystem::prewarmSteps(float seconds) const
+{
+	if (seconds <= 0.0f || m_emitters.empty())
+	{
+		return 0;
+	}
+
+	float step = PARTICLE_PREWARM_ANALYTIC_STEP;
+	for (auto emitter : m_emitters)
+	{
+		step = std::min(step, emitter->prewarmStep());
+	}
+	return (unsigned int)std::ceil(seconds / step);
+}
+
+/*
+* @description jumps to time on the timeline. restores a checkpoint and simulates the steps after it again, so the
+* result is what playing up to time would have given with the current Config
+* @method seek
+* @params {float} time - seconds since the timeline started
+* @return {bool} false if nothing could be restored
+*/
+bool ParticleSystem::seek(float time)
+{
+	uint64_t target = (uint64_t)std::llround(std::max(time, 0.0f) / clock.getFixedStep());
+	uint64_t checkpointStep;
+	if (!timeline.restore(target, checkpointStep, m_timelineState))
+	{
+		return false;
+	}
+	if (!loadState(m_timelineState))
+	{
+		timeline.clear(); // emitters were added or removed since, none of the checkpoints fit any more
+		return false;
+	}
+
+	m_step = checkpointStep;
+	clock.reset();
+
+	m_seeking = true;
+	while (m_step < target)
+	{
+		step(clock.getFixedStep());
+	}
+	m_seeking = false;
+	return true;
+}
+
+/*
+* @description packs every emitter's state into one block: the number of emitters, then each one's size and state
+* @method saveState
+* @params {std::vector<uint8_t>&} state
+* @return {void}
+*/
+void ParticleSystem::saveState(std::vector<uint8_t>& state) const
+{
+	size_t total = sizeof(uint32_t);
+	for (auto emitter : m_emitters)
+	{
+		total += sizeof(uint64_t) + emitter->stateSize();
+	}
+	state.resize(total);
+
+	uint8_t* out = state.data();
+	uint32_t numEmitters = (uint32_t)m_emitters.size();
+	memcpy(out, &numEmitters, sizeof(numEmitters));
+	out += sizeof(numEmitters);
+
+	for (auto emitter : m_emitters)
+	{
+		uint64_t size = emitter->stateSize();
+		memcpy(out, &size, sizeof(size));
+		out += sizeof(size);
+		emitter->saveState(out);
+		out += size;
+	}
+}
+
+/*
+* @description restores a block written by saveState, if the system still has the same number of emitters
+* @method loadState
+* @params {const std::vector<uint8_t>&} state
+* @return {bool}
+*/
+bool ParticleSystem::loadState(const std::vector<uint8_t>& state)
+{
+	const uint8_t* in = state.data();
+	const uint8_t* end = in + state.size();
+
+	uint32_t numEmitters;
+	if (state.size() < sizeof(numEmitters))
+	{
+		return false;
+	}
+	memcpy(&numEmitters, in, sizeof(numEmitters));
+	in += sizeof(numEmitters);
+	if (numEmitters != m_emitters.size())
+	{
+		return false;
+	}
+
+	// check everything before changing anything
+	const uint8_t* check = in;
+	for (auto emitter : m_emitters)
+	{
+		uint64_t size;
+		if (end - check < (ptrdiff_t)sizeof(size))
+		{
+			return false;
+		}
+		memcpy(&size, check, sizeof(size));
+		check += sizeof(size);
+		if ((uint64_t)(end - check) < size || size != emitter->stateSize(check, (size_t)size))
+		{
+			return false;
+		}
+		check += size;
+	}
+
+	for (auto emitter : m_emitters)
+	{
+		uint64_t size;
+		memcpy(&size, in, sizeof(size));
+		in += sizeof(size);
+		emitter->loadState(in);
+		in += size;
+	}
+	return true;
+}
+
+/*
+* @description hands every emitter's birth and death events to the sub-emitters they are linked to.
+* the new particles are first updated in the next step
+* @method dispatchEvents
+* @return {void}
+*/
+void ParticleSystem::dispatchEvents()
 {
 	for (auto emitter : m_emitters)
 	{
-		emitter->worldMatrix = parent->transformable->getTransform() * emitter->myConfig.transform.getTransform();
-		emitter->update(0.016f); //todo: temp dt solution
-		emitter->draw();
+		int links[2] = { emitter->myConfig.birthSubEmitter, emitter->myConfig.deathSubEmitter };
+		ParticleEventBuffer* buffers[2] = { &emitter->birthEvents, &emitter->deathEvents };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (links[i] >= 0 && links[i] < (int)m_emitters.size() && m_emitters[links[i]] != emitter)
+			{
+				m_emitters[links[i]]->spawnFromEvents(*buffers[i]);
+			}
+			buffers[i]->clear();
+		}
 	}
 }
 
@@ -1036,6 +2789,22 @@ void ParticleSystem::removeAt(size_t index)
 {
 	delete m_emitters[index];
 	m_emitters.erase(m_emitters.begin() + index);
+
+	// sub-emitter links are indices, keep them pointing at the same emitters
+	for (auto emitter : m_emitters)
+	{
+		for (int* link : { &emitter->myConfig.birthSubEmitter, &emitter->myConfig.deathSubEmitter })
+		{
+			if (*link == (int)index)
+			{
+				*link = -1;
+			}
+			else if (*link > (int)index)
+			{
+				--*link;
+			}
+		}
+	}
 }
 
 /*
@@ -1077,8 +2846,7 @@ ParticleEmitter * ParticleSystem::getEmitter(size_t index)
 */
 void ParticleSystem::removeEmitter()
 {
-	delete m_emitters.back();
-	m_emitters.pop_back();
+	removeAt(m_emitters.size() - 1); // clears the sub-emitter links to it
 }
 
 /*
@@ -0,0 +1,1229 @@
+#include "ParticleKernels.h"
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PSE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PSE_TARGET_AVX2 // msvc lets any function use avx intrinsics
+#else
+#include <cpuid.h>
+#define PSE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define PSE_X86 0
+#endif
+
+// intrinsics can't be compiled to MSIL, keep the kernels native when building with /clr
+#ifdef _M_CEE
+#pragma managed(push, off)
+#endif
+
+namespace algomath
+{
+#if PSE_X86
+	namespace
+	{
+		inline float horizontalMin(__m128 v)
+		{
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(v);
+		}
+
+		inline float horizontalMax(__m128 v)
+		{
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtss_f32(v);
+		}
+
+		// merges the lanes of the wide kernels' running bounds into bounds
+		inline void widenBounds(float* bounds, __m128 minX, __m128 minY, __m128 minZ, __m128 maxX, __m128 maxY, __m128 maxZ)
+		{
+			bounds[0] = std::min(bounds[0], horizontalMin(minX));
+			bounds[1] = std::min(bounds[1], horizontalMin(minY));
+			bounds[2] = std::min(bounds[2], horizontalMin(minZ));
+			bounds[3] = std::max(bounds[3], horizontalMax(maxX));
+			bounds[4] = std::max(bounds[4], horizontalMax(maxY));
+			bounds[5] = std::max(bounds[5], horizontalMax(maxZ));
+		}
+	}
+#endif
+
+	/*
+	 * @description reference implementation, also used for the leftover particles of the wide kernels
+	 * @method integrateParticlesScalar
+	 * @return {void}
+	 */
+	void integrateParticlesScalar(const IntegrationStreams& s, unsigned int begin, unsigned int end, float dt)
+	{
+		float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+		float maxX = -FLT_MAX, maxY = -FLT_MAX, maxZ = -FLT_MAX;
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			float mass = s.mass[i];
+			float ax = s.accelX[i] + s.forceX[i] / mass;
+			float ay = s.accelY[i] + s.forceY[i] / mass;
+			float az = s.accelZ[i] + s.forceZ[i] / mass;
+
+			float vx = s.velX[i] + ax * dt;
+			float vy = s.velY[i] + ay * dt;
+			float vz = s.velZ[i] + az * dt;
+
+			if (s.speedLimit)
+			{
+				float limit = s.speedLimit[i];
+				float speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+				if (speed > limit)
+				{
+					float scale = limit / speed;
+					vx *= scale;
+					vy *= scale;
+					vz *= scale;
+				}
+			}
+
+			float x = s.posX[i];
+			float y = s.posY[i];
+			float z = s.posZ[i];
+			float nx = x + vx * dt;
+			float ny = y + vy * dt;
+			float nz = z + vz * dt;
+			s.posX[i] = nx;
+			s.posY[i] = ny;
+			s.posZ[i] = nz;
+
+			minX = std::min(minX, std::min(x, nx));
+			minY = std::min(minY, std::min(y, ny));
+			minZ = std::min(minZ, std::min(z, nz));
+			maxX = std::max(maxX, std::max(x, nx));
+			maxY = std::max(maxY, std::max(y, ny));
+			maxZ = std::max(maxZ, std::max(z, nz));
+
+			s.velX[i] = vx;
+			s.velY[i] = vy;
+			s.velZ[i] = vz;
+
+			s.accelX[i] = 0.0f;
+			s.accelY[i] = 0.0f;
+			s.accelZ[i] = 0.0f;
+			s.forceX[i] = 0.0f;
+			s.forceY[i] = 0.0f;
+			s.forceZ[i] = 0.0f;
+
+			s.life[i] -= dt;
+		}
+
+		if (s.bounds)
+		{
+			s.bounds[0] = std::min(s.bounds[0], minX);
+			s.bounds[1] = std::min(s.bounds[1], minY);
+			s.bounds[2] = std::min(s.bounds[2], minZ);
+			s.bounds[3] = std::max(s.bounds[3], maxX);
+			s.bounds[4] = std::max(s.bounds[4], maxY);
+			s.bounds[5] = std::max(s.bounds[5], maxZ);
+		}
+	}
+
+#if PSE_X86
+	/*
+	 * @description integrates 4 particles per iteration
+	 * @method integrateParticlesSSE2
+	 * @return {void}
+	 */
+	void integrateParticlesSSE2(const IntegrationStreams& s, unsigned int begin, unsigned int end, float dt)
+	{
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		__m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		unsigned int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 mass = _mm_loadu_ps(s.mass + i);
+			__m128 ax = _mm_add_ps(_mm_loadu_ps(s.accelX + i), _mm_div_ps(_mm_loadu_ps(s.forceX + i), mass));
+			__m128 ay = _mm_add_ps(_mm_loadu_ps(s.accelY + i), _mm_div_ps(_mm_loadu_ps(s.forceY + i), mass));
+			__m128 az = _mm_add_ps(_mm_loadu_ps(s.accelZ + i), _mm_div_ps(_mm_loadu_ps(s.forceZ + i), mass));
+
+			__m128 vx = _mm_add_ps(_mm_loadu_ps(s.velX + i), _mm_mul_ps(ax, vdt));
+			__m128 vy = _mm_add_ps(_mm_loadu_ps(s.velY + i), _mm_mul_ps(ay, vdt));
+			__m128 vz = _mm_add_ps(_mm_loadu_ps(s.velZ + i), _mm_mul_ps(az, vdt));
+
+			if (s.speedLimit)
+			{
+				__m128 limit = _mm_loadu_ps(s.speedLimit + i);
+				__m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+				__m128 over = _mm_cmpgt_ps(speed, limit);
+				__m128 scale = _mm_div_ps(limit, speed);
+				scale = _mm_or_ps(_mm_and_ps(over, scale), _mm_andnot_ps(over, one)); // no sse4 blend in sse2
+				vx = _mm_mul_ps(vx, scale);
+				vy = _mm_mul_ps(vy, scale);
+				vz = _mm_mul_ps(vz, scale);
+			}
+
+			__m128 x = _mm_loadu_ps(s.posX + i);
+			__m128 y = _mm_loadu_ps(s.posY + i);
+			__m128 z = _mm_loadu_ps(s.posZ + i);
+			__m128 nx = _mm_add_ps(x, _mm_mul_ps(vx, vdt));
+			__m128 ny = _mm_add_ps(y, _mm_mul_ps(vy, vdt));
+			__m128 nz = _mm_add_ps(z, _mm_mul_ps(vz, vdt));
+			_mm_storeu_ps(s.posX + i, nx);
+			_mm_storeu_ps(s.posY + i, ny);
+			_mm_storeu_ps(s.posZ + i, nz);
+
+			minX = _mm_min_ps(minX, _mm_min_ps(x, nx));
+			minY = _mm_min_ps(minY, _mm_min_ps(y, ny));
+			minZ = _mm_min_ps(minZ, _mm_min_ps(z, nz));
+			maxX = _mm_max_ps(maxX, _mm_max_ps(x, nx));
+			maxY = _mm_max_ps(maxY, _mm_max_ps(y, ny));
+			maxZ = _mm_max_ps(maxZ, _mm_max_ps(z, nz));
+
+			_mm_storeu_ps(s.velX + i, vx);
+			_mm_storeu_ps(s.velY + i, vy);
+			_mm_storeu_ps(s.velZ + i, vz);
+
+			_mm_storeu_ps(s.accelX + i, zero);
+			_mm_storeu_ps(s.accelY + i, zero);
+			_mm_storeu_ps(s.accelZ + i, zero);
+			_mm_storeu_ps(s.forceX + i, zero);
+			_mm_storeu_ps(s.forceY + i, zero);
+			_mm_storeu_ps(s.forceZ + i, zero);
+
+			_mm_storeu_ps(s.life + i, _mm_sub_ps(_mm_loadu_ps(s.life + i), vdt));
+		}
+
+		if (s.bounds)
+		{
+			widenBounds(s.bounds, minX, minY, minZ, maxX, maxY, maxZ);
+		}
+
+		integrateParticlesScalar(s, i, end, dt);
+	}
+
+	/*
+	 * @description integrates 8 particles per iteration
+	 * @method integrateParticlesAVX2
+	 * @return {void}
+	 */
+	PSE_TARGET_AVX2 void integrateParticlesAVX2(const IntegrationStreams& s, unsigned int begin, unsigned int end, float dt)
+	{
+		const __m256 vdt = _mm256_set1_ps(dt);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 minX = _mm256_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		__m256 maxX = _mm256_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		unsigned int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 mass = _mm256_loadu_ps(s.mass + i);
+			__m256 ax = _mm256_add_ps(_mm256_loadu_ps(s.accelX + i), _mm256_div_ps(_mm256_loadu_ps(s.forceX + i), mass));
+			__m256 ay = _mm256_add_ps(_mm256_loadu_ps(s.accelY + i), _mm256_div_ps(_mm256_loadu_ps(s.forceY + i), mass));
+			__m256 az = _mm256_add_ps(_mm256_loadu_ps(s.accelZ + i), _mm256_div_ps(_mm256_loadu_ps(s.forceZ + i), mass));
+
+			__m256 vx = _mm256_add_ps(_mm256_loadu_ps(s.velX + i), _mm256_mul_ps(ax, vdt));
+			__m256 vy = _mm256_add_ps(_mm256_loadu_ps(s.velY + i), _mm256_mul_ps(ay, vdt));
+			__m256 vz = _mm256_add_ps(_mm256_loadu_ps(s.velZ + i), _mm256_mul_ps(az, vdt));
+
+			if (s.speedLimit)
+			{
+				__m256 limit = _mm256_loadu_ps(s.speedLimit + i);
+				__m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz)));
+				__m256 over = _mm256_cmp_ps(speed, limit, _CMP_GT_OQ);
+				__m256 scale = _mm256_blendv_ps(one, _mm256_div_ps(limit, speed), over);
+				vx = _mm256_mul_ps(vx, scale);
+				vy = _mm256_mul_ps(vy, scale);
+				vz = _mm256_mul_ps(vz, scale);
+			}
+
+			__m256 x = _mm256_loadu_ps(s.posX + i);
+			__m256 y = _mm256_loadu_ps(s.posY + i);
+			__m256 z = _mm256_loadu_ps(s.posZ + i);
+			__m256 nx = _mm256_add_ps(x, _mm256_mul_ps(vx, vdt));
+			__m256 ny = _mm256_add_ps(y, _mm256_mul_ps(vy, vdt));
+			__m256 nz = _mm256_add_ps(z, _mm256_mul_ps(vz, vdt));
+			_mm256_storeu_ps(s.posX + i, nx);
+			_mm256_storeu_ps(s.posY + i, ny);
+			_mm256_storeu_ps(s.posZ + i, nz);
+
+			minX = _mm256_min_ps(minX, _mm256_min_ps(x, nx));
+			minY = _mm256_min_ps(minY, _mm256_min_ps(y, ny));
+			minZ = _mm256_min_ps(minZ, _mm256_min_ps(z, nz));
+			maxX = _mm256_max_ps(maxX, _mm256_max_ps(x, nx));
+			maxY = _mm256_max_ps(maxY, _mm256_max_ps(y, ny));
+			maxZ = _mm256_max_ps(maxZ, _mm256_max_ps(z, nz));
+
+			_mm256_storeu_ps(s.velX + i, vx);
+			_mm256_storeu_ps(s.velY + i, vy);
+			_mm256_storeu_ps(s.velZ + i, vz);
+
+			_mm256_storeu_ps(s.accelX + i, zero);
+			_mm256_storeu_ps(s.accelY + i, zero);
+			_mm256_storeu_ps(s.accelZ + i, zero);
+			_mm256_storeu_ps(s.forceX + i, zero);
+			_mm256_storeu_ps(s.forceY + i, zero);
+			_mm256_storeu_ps(s.forceZ + i, zero);
+
+			_mm256_storeu_ps(s.life + i, _mm256_sub_ps(_mm256_loadu_ps(s.life + i), vdt));
+		}
+
+		if (s.bounds)
+		{
+			widenBounds(s.bounds,
+				_mm_min_ps(_mm256_castps256_ps128(minX), _mm256_extractf128_ps(minX, 1)),
+				_mm_min_ps(_mm256_castps256_ps128(minY), _mm256_extractf128_ps(minY, 1)),
+				_mm_min_ps(_mm256_castps256_ps128(minZ), _mm256_extractf128_ps(minZ, 1)),
+				_mm_max_ps(_mm256_castps256_ps128(maxX), _mm256_extractf128_ps(maxX, 1)),
+				_mm_max_ps(_mm256_castps256_ps128(maxY), _mm256_extractf128_ps(maxY, 1)),
+				_mm_max_ps(_mm256_castps256_ps128(maxZ), _mm256_extractf128_ps(maxZ, 1)));
+		}
+
+		_mm256_zeroupper(); // avoid the avx -> sse transition penalty in the scalar tail
+
+		integrateParticlesScalar(s, i, end, dt);
+	}
+#else
+	void integrateParticlesSSE2(const IntegrationStreams& s, unsigned int begin, unsigned int end, float dt)
+	{
+		integrateParticlesScalar(s, begin, end, dt);
+	}
+
+	void integrateParticlesAVX2(const IntegrationStreams& s, unsigned int begin, unsigned int end, float dt)
+	{
+		integrateParticlesScalar(s, begin, end, dt);
+	}
+#endif
+
+	/*
+	 * @description finds the widest instruction set that both the cpu and the OS support
+	 * @method detectSimdLevel
+	 * @return {SIMD_LEVEL}
+	 */
+	SIMD_LEVEL detectSimdLevel()
+	{
+#if PSE_X86
+		unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+		unsigned int maxLeaf = 0;
+
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		maxLeaf = info[0];
+		__cpuid(info, 1);
+		ecx = info[2];
+		edx = info[3];
+#else
+		__get_cpuid(0, &maxLeaf, &ebx, &ecx, &edx);
+		__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+
+		bool sse2 = (edx & (1u << 26)) != 0;
+		bool osxsave = (ecx & (1u << 27)) != 0;
+		bool avx = (ecx & (1u << 28)) != 0;
+
+		if (!sse2)
+		{
+			return SIMD_SCALAR;
+		}
+
+		// the OS has to save the ymm registers on context switches, otherwise avx is unusable
+		bool ymmState = false;
+		if (osxsave && avx)
+		{
+#if defined(_MSC_VER)
+			unsigned long long xcr0 = _xgetbv(0);
+#else
+			unsigned int xcrLow = 0, xcrHigh = 0;
+			__asm__ volatile("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+			unsigned long long xcr0 = ((unsigned long long)xcrHigh << 32) | xcrLow;
+#endif
+			ymmState = (xcr0 & 0x6) == 0x6;
+		}
+
+		bool avx2 = false;
+		if (ymmState && maxLeaf >= 7)
+		{
+#if defined(_MSC_VER)
+			__cpuidex(info, 7, 0);
+			ebx = info[1];
+#else
+			__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+#endif
+			avx2 = (ebx & (1u << 5)) != 0;
+		}
+
+		return avx2 ? SIMD_AVX2 : SIMD_SSE2;
+#else
+		return SIMD_SCALAR;
+#endif
+	}
+
+	const char* simdLevelName(SIMD_LEVEL level)
+	{
+		switch (level)
+		{
+		case SIMD_AVX2:
+			return "AVX2";
+		case SIMD_SSE2:
+			return "SSE2";
+		default:
+		case SIMD_SCALAR:
+			return "scalar";
+		}
+	}
+
+	/*
+	 * @description min/max reduction over positions. only needed where something moved particles after integration
+	 * widened the bounds, so a scalar loop the compiler can vectorise is enough
+	 * @method boundParticles
+	 * @return {void}
+	 */
+	void boundParticles(const float* posX, const float* posY, const float* posZ, unsigned int begin, unsigned int end, float* bounds)
+	{
+		float minX = bounds[0], minY = bounds[1], minZ = bounds[2];
+		float maxX = bounds[3], maxY = bounds[4], maxZ = bounds[5];
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			minX = std::min(minX, posX[i]);
+			minY = std::min(minY, posY[i]);
+			minZ = std::min(minZ, posZ[i]);
+			maxX = std::max(maxX, posX[i]);
+			maxY = std::max(maxY, posY[i]);
+			maxZ = std::max(maxZ, posZ[i]);
+		}
+		bounds[0] = minX;
+		bounds[1] = minY;
+		bounds[2] = minZ;
+		bounds[3] = maxX;
+		bounds[4] = maxY;
+		bounds[5] = maxZ;
+	}
+
+	namespace
+	{
+		/*
+		 * @description pushes particle i out of collider if it is inside, then bounces or kills it
+		 * @method resolveCollision
+		 * @return {void}
+		 */
+		inline void resolveCollision(const CollisionStreams& s, const ColliderShape& c, unsigned int i)
+		{
+			glm::vec3 position(s.posX[i], s.posY[i], s.posZ[i]);
+			glm::vec3 offset = position - c.centre;
+			glm::vec3 normal;
+			glm::vec3 surface;
+
+			switch (c.shape)
+			{
+			case COLLIDER_PLANE:
+			{
+				float distance = glm::dot(offset, c.axes[2]);
+				if (distance >= 0.0f)
+				{
+					return;
+				}
+				normal = c.axes[2];
+				surface = position - normal * distance;
+				break;
+			}
+			case COLLIDER_BOX:
+			{
+				// leave through the nearest face
+				int nearest = -1;
+				float nearestDepth = 0.0f;
+				float nearestSide = 1.0f;
+				for (int a = 0; a < 3; ++a)
+				{
+					float local = glm::dot(offset, c.axes[a]);
+					float depth = c.halfExtents[a] - std::fabs(local);
+					if (depth <= 0.0f)
+					{
+						return;
+					}
+					if (nearest < 0 || depth < nearestDepth)
+					{
+						nearest = a;
+						nearestDepth = depth;
+						nearestSide = (local < 0.0f) ? -1.0f : 1.0f;
+					}
+				}
+				normal = c.axes[nearest] * nearestSide;
+				surface = position + normal * nearestDepth;
+				break;
+			}
+			case COLLIDER_SPHERE:
+			case COLLIDER_CAPSULE:
+			default:
+			{
+				// a capsule is a sphere around the closest point of its axis
+				glm::vec3 core = c.centre;
+				if (c.shape == COLLIDER_CAPSULE)
+				{
+					float along = glm::clamp(glm::dot(offset, c.axes[2]), -c.halfLength, c.halfLength);
+					core += c.axes[2] * along;
+				}
+
+				glm::vec3 away = position - core;
+				float distance2 = glm::dot(away, away);
+				if (distance2 >= c.radius * c.radius)
+				{
+					return;
+				}
+				normal = (distance2 > 1e-12f) ? away / std::sqrt(distance2) : c.axes[2];
+				surface = core + normal * c.radius;
+				break;
+			}
+			}
+
+			if (c.response == COLLISION_KILL)
+			{
+				s.life[i] = 0.0f;
+				return;
+			}
+
+			s.posX[i] = surface.x;
+			s.posY[i] = surface.y;
+			s.posZ[i] = surface.z;
+
+			// only reflect particles still heading in, ones already leaving keep their speed
+			glm::vec3 velocity(s.velX[i], s.velY[i], s.velZ[i]);
+			float speedIn = glm::dot(velocity, normal);
+			if (speedIn < 0.0f)
+			{
+				glm::vec3 normalVelocity = normal * speedIn;
+				velocity = (velocity - normalVelocity) * (1.0f - c.friction) - normalVelocity * c.bounce;
+				s.velX[i] = velocity.x;
+				s.velY[i] = velocity.y;
+				s.velZ[i] = velocity.z;
+			}
+		}
+	}
+
+	/*
+	 * @description reference implementation, also used for the leftover particles of the wide kernels
+	 * @method collideParticlesScalar
+	 * @return {void}
+	 */
+	void collideParticlesScalar(const CollisionStreams& s, const ColliderShape& collider, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			resolveCollision(s, collider, i);
+		}
+	}
+
+#if PSE_X86
+	namespace
+	{
+		inline __m128 dot3(__m128 x, __m128 y, __m128 z, const glm::vec3& v)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(v.x)), _mm_mul_ps(y, _mm_set1_ps(v.y))), _mm_mul_ps(z, _mm_set1_ps(v.z)));
+		}
+
+		/*
+		 * @description tests 4 particles at a time and only resolves the ones inside. the shape is a template
+		 * parameter so each shape gets its own loop with no switch inside it
+		 * @method collideShapeSSE2
+		 * @return {void}
+		 */
+		template<int SHAPE>
+		void collideShapeSSE2(const CollisionStreams& s, const ColliderShape& c, unsigned int begin, unsigned int end)
+		{
+			const __m128 cx = _mm_set1_ps(c.centre.x);
+			const __m128 cy = _mm_set1_ps(c.centre.y);
+			const __m128 cz = _mm_set1_ps(c.centre.z);
+			const __m128 radius2 = _mm_set1_ps(c.radius * c.radius);
+			const __m128 halfLength = _mm_set1_ps(c.halfLength);
+			const __m128 negHalfLength = _mm_set1_ps(-c.halfLength);
+			const __m128 hx = _mm_set1_ps(c.halfExtents.x);
+			const __m128 hy = _mm_set1_ps(c.halfExtents.y);
+			const __m128 hz = _mm_set1_ps(c.halfExtents.z);
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+			const __m128 zero = _mm_setzero_ps();
+
+			unsigned int i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 dx = _mm_sub_ps(_mm_loadu_ps(s.posX + i), cx);
+				__m128 dy = _mm_sub_ps(_mm_loadu_ps(s.posY + i), cy);
+				__m128 dz = _mm_sub_ps(_mm_loadu_ps(s.posZ + i), cz);
+				__m128 inside;
+
+				if (SHAPE == COLLIDER_PLANE)
+				{
+					inside = _mm_cmplt_ps(dot3(dx, dy, dz, c.axes[2]), zero);
+				}
+				else if (SHAPE == COLLIDER_BOX)
+				{
+					__m128 lx = _mm_and_ps(dot3(dx, dy, dz, c.axes[0]), absMask);
+					__m128 ly = _mm_and_ps(dot3(dx, dy, dz, c.axes[1]), absMask);
+					__m128 lz = _mm_and_ps(dot3(dx, dy, dz, c.axes[2]), absMask);
+					inside = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(lx, hx), _mm_cmplt_ps(ly, hy)), _mm_cmplt_ps(lz, hz));
+				}
+				else
+				{
+					if (SHAPE == COLLIDER_CAPSULE)
+					{
+						__m128 along = _mm_min_ps(_mm_max_ps(dot3(dx, dy, dz, c.axes[2]), negHalfLength), halfLength);
+						dx = _mm_sub_ps(dx, _mm_mul_ps(along, _mm_set1_ps(c.axes[2].x)));
+						dy = _mm_sub_ps(dy, _mm_mul_ps(along, _mm_set1_ps(c.axes[2].y)));
+						dz = _mm_sub_ps(dz, _mm_mul_ps(along, _mm_set1_ps(c.axes[2].z)));
+					}
+					__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					inside = _mm_cmplt_ps(distance2, radius2);
+				}
+
+				int hits = _mm_movemask_ps(inside);
+				while (hits)
+				{
+					unsigned int lane = 0;
+					while (!(hits & (1 << lane)))
+					{
+						++lane;
+					}
+					hits &= ~(1 << lane);
+					resolveCollision(s, c, i + lane);
+				}
+			}
+
+			collideParticlesScalar(s, c, i, end);
+		}
+	}
+
+	void collideParticlesSSE2(const CollisionStreams& s, const ColliderShape& collider, unsigned int begin, unsigned int end)
+	{
+		switch (collider.shape)
+		{
+		case COLLIDER_PLANE:
+			collideShapeSSE2<COLLIDER_PLANE>(s, collider, begin, end);
+			break;
+		case COLLIDER_BOX:
+			collideShapeSSE2<COLLIDER_BOX>(s, collider, begin, end);
+			break;
+		case COLLIDER_CAPSULE:
+			collideShapeSSE2<COLLIDER_CAPSULE>(s, collider, begin, end);
+			break;
+		default:
+		case COLLIDER_SPHERE:
+			collideShapeSSE2<COLLIDER_SPHERE>(s, collider, begin, end);
+			break;
+		}
+	}
+#else
+	void collideParticlesSSE2(const CollisionStreams& s, const ColliderShape& collider, unsigned int begin, unsigned int end)
+	{
+		collideParticlesScalar(s, collider, begin, end);
+	}
+#endif
+
+	/*
+	 * @description reference implementation, also used for the leftover particles of the wide kernels
+	 * @method applyVectorFieldScalar
+	 * @return {void}
+	 */
+	void applyVectorFieldScalar(const VectorFieldStreams& s, const VectorFieldSampler& f, unsigned int begin, unsigned int end)
+	{
+		const int sizeX = f.size[0], sizeY = f.size[1], sizeZ = f.size[2];
+		const size_t strideY = (size_t)sizeX;
+		const size_t strideZ = (size_t)sizeX * sizeY;
+		const float* components[3] = { f.x, f.y, f.z };
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			float g[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				g[a] = f.toGrid[a][0] * s.posX[i] + f.toGrid[a][1] * s.posY[i] + f.toGrid[a][2] * s.posZ[i] + f.toGrid[a][3];
+			}
+
+			// the field only acts inside its box. written so NaN positions fail the test too
+			if (!(g[0] >= 0.0f && g[0] <= sizeX - 1 && g[1] >= 0.0f && g[1] <= sizeY - 1 && g[2] >= 0.0f && g[2] <= sizeZ - 1))
+			{
+				continue;
+			}
+
+			int cell[3];
+			float t[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				cell[a] = (int)g[a];
+				if (cell[a] > f.size[a] - 2)
+				{
+					cell[a] = f.size[a] - 2;
+				}
+				t[a] = g[a] - cell[a];
+			}
+
+			size_t base = cell[0] + cell[1] * strideY + cell[2] * strideZ;
+			float v[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				const float* d = components[c] + base;
+				float c00 = d[0] + (d[1] - d[0]) * t[0];
+				float c10 = d[strideY] + (d[strideY + 1] - d[strideY]) * t[0];
+				float c01 = d[strideZ] + (d[strideZ + 1] - d[strideZ]) * t[0];
+				float c11 = d[strideZ + strideY] + (d[strideZ + strideY + 1] - d[strideZ + strideY]) * t[0];
+				float c0 = c00 + (c10 - c00) * t[1];
+				float c1 = c01 + (c11 - c01) * t[1];
+				v[c] = (c0 + (c1 - c0) * t[2]) * f.strength;
+			}
+
+			if (f.mode == VECTOR_FIELD_VELOCITY)
+			{
+				v[0] -= s.velX[i];
+				v[1] -= s.velY[i];
+				v[2] -= s.velZ[i];
+			}
+
+			s.forceX[i] += v[0];
+			s.forceY[i] += v[1];
+			s.forceZ[i] += v[2];
+		}
+	}
+
+#if PSE_X86
+	/*
+	 * @description samples 4 particles per iteration. sse2 has no gather, so the corners are loaded one by one
+	 * and everything around the loads is vectorized
+	 * @method applyVectorFieldSSE2
+	 * @return {void}
+	 */
+	void applyVectorFieldSSE2(const VectorFieldStreams& s, const VectorFieldSampler& f, unsigned int begin, unsigned int end)
+	{
+		const size_t strideY = (size_t)f.size[0];
+		const size_t strideZ = (size_t)f.size[0] * f.size[1];
+		const float* components[3] = { f.x, f.y, f.z };
+
+		__m128 row[3][4];
+		__m128 last[3];
+		__m128 lastCell[3];
+		for (int a = 0; a < 3; ++a)
+		{
+			for (int b = 0; b < 4; ++b)
+			{
+				row[a][b] = _mm_set1_ps(f.toGrid[a][b]);
+			}
+			last[a] = _mm_set1_ps((float)(f.size[a] - 1));
+			lastCell[a] = _mm_set1_ps((float)(f.size[a] - 2));
+		}
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 strength = _mm_set1_ps(f.strength);
+		const bool velocityMode = (f.mode == VECTOR_FIELD_VELOCITY);
+
+		unsigned int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 px = _mm_loadu_ps(s.posX + i);
+			__m128 py = _mm_loadu_ps(s.posY + i);
+			__m128 pz = _mm_loadu_ps(s.posZ + i);
+
+			__m128 g[3];
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int a = 0; a < 3; ++a)
+			{
+				g[a] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[a][0], px), _mm_mul_ps(row[a][1], py)), _mm_add_ps(_mm_mul_ps(row[a][2], pz), row[a][3]));
+				inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(g[a], zero), _mm_cmple_ps(g[a], last[a])));
+			}
+
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			// clamped so lanes outside the box still read valid memory, their result is masked off below
+			__m128 t[3];
+			__m128 cell[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				__m128 clamped = _mm_min_ps(_mm_max_ps(g[a], zero), last[a]);
+				cell[a] = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(clamped)), lastCell[a]);
+				t[a] = _mm_sub_ps(clamped, cell[a]);
+			}
+
+			// the index is built in integers, in float it would stop being exact past 2^24 cells. sse2 has no 32 bit
+			// multiply so it is done per lane, the lanes are loaded one by one anyway
+			alignas(16) int32_t cellIndex[3][4];
+			for (int a = 0; a < 3; ++a)
+			{
+				_mm_store_si128((__m128i*)cellIndex[a], _mm_cvttps_epi32(cell[a]));
+			}
+			size_t base[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				base[k] = cellIndex[0][k] + cellIndex[1][k] * strideY + cellIndex[2][k] * strideZ;
+			}
+
+			__m128 v[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				const float* d = components[c];
+				auto corner = [d, &base](size_t offset)
+				{
+					return _mm_setr_ps(d[base[0] + offset], d[base[1] + offset], d[base[2] + offset], d[base[3] + offset]);
+				};
+				auto lerp4 = [](__m128 a, __m128 b, __m128 w)
+				{
+					return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), w));
+				};
+
+				__m128 c00 = lerp4(corner(0), corner(1), t[0]);
+				__m128 c10 = lerp4(corner(strideY), corner(strideY + 1), t[0]);
+				__m128 c01 = lerp4(corner(strideZ), corner(strideZ + 1), t[0]);
+				__m128 c11 = lerp4(corner(strideZ + strideY), corner(strideZ + strideY + 1), t[0]);
+				v[c] = _mm_mul_ps(lerp4(lerp4(c00, c10, t[1]), lerp4(c01, c11, t[1]), t[2]), strength);
+			}
+
+			if (velocityMode)
+			{
+				v[0] = _mm_sub_ps(v[0], _mm_loadu_ps(s.velX + i));
+				v[1] = _mm_sub_ps(v[1], _mm_loadu_ps(s.velY + i));
+				v[2] = _mm_sub_ps(v[2], _mm_loadu_ps(s.velZ + i));
+			}
+
+			_mm_storeu_ps(s.forceX + i, _mm_add_ps(_mm_loadu_ps(s.forceX + i), _mm_and_ps(v[0], inside)));
+			_mm_storeu_ps(s.forceY + i, _mm_add_ps(_mm_loadu_ps(s.forceY + i), _mm_and_ps(v[1], inside)));
+			_mm_storeu_ps(s.forceZ + i, _mm_add_ps(_mm_loadu_ps(s.forceZ + i), _mm_and_ps(v[2], inside)));
+		}
+
+		applyVectorFieldScalar(s, f, i, end);
+	}
+
+	namespace
+	{
+		// plain functions rather than lambdas, a lambda would not pick up the avx2 target on gcc
+		PSE_TARGET_AVX2 inline __m256 gather8(const float* d, __m256i base, int offset)
+		{
+			return _mm256_i32gather_ps(d + offset, base, 4);
+		}
+
+		PSE_TARGET_AVX2 inline __m256 lerp8(__m256 a, __m256 b, __m256 w)
+		{
+			return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), w));
+		}
+	}
+
+	/*
+	 * @description samples 8 particles per iteration, fetching the corners with avx2 gathers
+	 * @method applyVectorFieldAVX2
+	 * @return {void}
+	 */
+	PSE_TARGET_AVX2 void applyVectorFieldAVX2(const VectorFieldStreams& s, const VectorFieldSampler& f, unsigned int begin, unsigned int end)
+	{
+		const int strideY = f.size[0];
+		const int strideZ = f.size[0] * f.size[1];
+		const float* components[3] = { f.x, f.y, f.z };
+
+		__m256 row[3][4];
+		__m256 last[3];
+		__m256 lastCell[3];
+		for (int a = 0; a < 3; ++a)
+		{
+			for (int b = 0; b < 4; ++b)
+			{
+				row[a][b] = _mm256_set1_ps(f.toGrid[a][b]);
+			}
+			last[a] = _mm256_set1_ps((float)(f.size[a] - 1));
+			lastCell[a] = _mm256_set1_ps((float)(f.size[a] - 2));
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 strength = _mm256_set1_ps(f.strength);
+		const __m256i vStrideY = _mm256_set1_epi32(strideY);
+		const __m256i vStrideZ = _mm256_set1_epi32(strideZ);
+		const bool velocityMode = (f.mode == VECTOR_FIELD_VELOCITY);
+
+		unsigned int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 px = _mm256_loadu_ps(s.posX + i);
+			__m256 py = _mm256_loadu_ps(s.posY + i);
+			__m256 pz = _mm256_loadu_ps(s.posZ + i);
+
+			__m256 g[3];
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int a = 0; a < 3; ++a)
+			{
+				g[a] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[a][0], px), _mm256_mul_ps(row[a][1], py)), _mm256_add_ps(_mm256_mul_ps(row[a][2], pz), row[a][3]));
+				inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(g[a], zero, _CMP_GE_OQ), _mm256_cmp_ps(g[a], last[a], _CMP_LE_OQ)));
+			}
+
+			if (_mm256_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			__m256 t[3];
+			__m256 cell[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				__m256 clamped = _mm256_min_ps(_mm256_max_ps(g[a], zero), last[a]);
+				cell[a] = _mm256_min_ps(_mm256_floor_ps(clamped), lastCell[a]);
+				t[a] = _mm256_sub_ps(clamped, cell[a]);
+			}
+
+			// built in integers, VECTOR_FIELD_MAX_CELLS keeps it inside the gathers' 32 bit offsets
+			__m256i base = _mm256_add_epi32(_mm256_cvttps_epi32(cell[0]),
+				_mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(cell[1]), vStrideY), _mm256_mullo_epi32(_mm256_cvttps_epi32(cell[2]), vStrideZ)));
+
+			__m256 v[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				const float* d = components[c];
+				__m256 c00 = lerp8(gather8(d, base, 0), gather8(d, base, 1), t[0]);
+				__m256 c10 = lerp8(gather8(d, base, strideY), gather8(d, base, strideY + 1), t[0]);
+				__m256 c01 = lerp8(gather8(d, base, strideZ), gather8(d, base, strideZ + 1), t[0]);
+				__m256 c11 = lerp8(gather8(d, base, strideZ + strideY), gather8(d, base, strideZ + strideY + 1), t[0]);
+				v[c] = _mm256_mul_ps(lerp8(lerp8(c00, c10, t[1]), lerp8(c01, c11, t[1]), t[2]), strength);
+			}
+
+			if (velocityMode)
+			{
+				v[0] = _mm256_sub_ps(v[0], _mm256_loadu_ps(s.velX + i));
+				v[1] = _mm256_sub_ps(v[1], _mm256_loadu_ps(s.velY + i));
+				v[2] = _mm256_sub_ps(v[2], _mm256_loadu_ps(s.velZ + i));
+			}
+
+			_mm256_storeu_ps(s.forceX + i, _mm256_add_ps(_mm256_loadu_ps(s.forceX + i), _mm256_and_ps(v[0], inside)));
+			_mm256_storeu_ps(s.forceY + i, _mm256_add_ps(_mm256_loadu_ps(s.forceY + i), _mm256_and_ps(v[1], inside)));
+			_mm256_storeu_ps(s.forceZ + i, _mm256_add_ps(_mm256_loadu_ps(s.forceZ + i), _mm256_and_ps(v[2], inside)));
+		}
+
+		_mm256_zeroupper();
+
+		applyVectorFieldScalar(s, f, i, end);
+	}
+#else
+	void applyVectorFieldSSE2(const VectorFieldStreams& s, const VectorFieldSampler& f, unsigned int begin, unsigned int end)
+	{
+		applyVectorFieldScalar(s, f, begin, end);
+	}
+
+	void applyVectorFieldAVX2(const VectorFieldStreams& s, const VectorFieldSampler& f, unsigned int begin, unsigned int end)
+	{
+		applyVectorFieldScalar(s, f, begin, end);
+	}
+#endif
+
+	/*
+	 * @description culls one particle at a time
+	 * @method cullParticlesScalar
+	 * @return {unsigned int} number of visible particles
+	 */
+	unsigned int cullParticlesScalar(const CullStreams& s, const CullView& v, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		unsigned int numVisible = 0;
+		float t = v.interpolation;
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			float x = s.prevX[i] + (s.posX[i] - s.prevX[i]) * t;
+			float y = s.prevY[i] + (s.posY[i] - s.prevY[i]) * t;
+			float z = s.prevZ[i] + (s.posZ[i] - s.prevZ[i]) * t;
+			float radius = s.size[i] * v.radiusScale;
+
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+			{
+				inside = (v.planes[p][0] * x + v.planes[p][1] * y + v.planes[p][2] * z + v.planes[p][3]) >= -radius;
+			}
+
+			if (inside && v.sizeFactor > 0.0f)
+			{
+				float nearDistance = v.planes[4][0] * x + v.planes[4][1] * y + v.planes[4][2] * z + v.planes[4][3];
+				inside = radius * v.sizeFactor >= nearDistance;
+			}
+
+			visible[numVisible] = i;
+			numVisible += inside ? 1 : 0;
+		}
+
+		return numVisible;
+	}
+
+#if PSE_X86
+	/*
+	 * @description culls 4 particles per iteration. every plane is tested for all four, then the visible ones are
+	 * packed into the output from the mask
+	 * @method cullParticlesSSE2
+	 * @return {unsigned int} number of visible particles
+	 */
+	unsigned int cullParticlesSSE2(const CullStreams& s, const CullView& v, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				planes[p][c] = _mm_set1_ps(v.planes[p][c]);
+			}
+		}
+		const __m128 t = _mm_set1_ps(v.interpolation);
+		const __m128 radiusScale = _mm_set1_ps(v.radiusScale);
+		const __m128 sizeFactor = _mm_set1_ps(v.sizeFactor);
+		const __m128 zero = _mm_setzero_ps();
+		const bool testSize = v.sizeFactor > 0.0f;
+
+		unsigned int numVisible = 0;
+		unsigned int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 px = _mm_loadu_ps(s.prevX + i);
+			__m128 py = _mm_loadu_ps(s.prevY + i);
+			__m128 pz = _mm_loadu_ps(s.prevZ + i);
+			__m128 x = _mm_add_ps(px, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.posX + i), px), t));
+			__m128 y = _mm_add_ps(py, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.posY + i), py), t));
+			__m128 z = _mm_add_ps(pz, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s.posZ + i), pz), t));
+			__m128 radius = _mm_mul_ps(_mm_loadu_ps(s.size + i), radiusScale);
+			__m128 negRadius = _mm_sub_ps(zero, radius);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			__m128 nearDistance = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+				if (p == 4)
+				{
+					nearDistance = distance;
+				}
+			}
+			if (testSize)
+			{
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_mul_ps(radius, sizeFactor), nearDistance));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (unsigned int k = 0; k < 4; ++k)
+			{
+				visible[numVisible] = i + k;
+				numVisible += (mask >> k) & 1;
+			}
+		}
+
+		return numVisible + cullParticlesScalar(s, v, i, end, visible + numVisible);
+	}
+
+	/*
+	 * @description culls 8 particles per iteration
+	 * @method cullParticlesAVX2
+	 * @return {unsigned int} number of visible particles
+	 */
+	PSE_TARGET_AVX2 unsigned int cullParticlesAVX2(const CullStreams& s, const CullView& v, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				planes[p][c] = _mm256_set1_ps(v.planes[p][c]);
+			}
+		}
+		const __m256 t = _mm256_set1_ps(v.interpolation);
+		const __m256 radiusScale = _mm256_set1_ps(v.radiusScale);
+		const __m256 sizeFactor = _mm256_set1_ps(v.sizeFactor);
+		const __m256 zero = _mm256_setzero_ps();
+		const bool testSize = v.sizeFactor > 0.0f;
+
+		unsigned int numVisible = 0;
+		unsigned int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 px = _mm256_loadu_ps(s.prevX + i);
+			__m256 py = _mm256_loadu_ps(s.prevY + i);
+			__m256 pz = _mm256_loadu_ps(s.prevZ + i);
+			__m256 x = _mm256_add_ps(px, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(s.posX + i), px), t));
+			__m256 y = _mm256_add_ps(py, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(s.posY + i), py), t));
+			__m256 z = _mm256_add_ps(pz, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(s.posZ + i), pz), t));
+			__m256 radius = _mm256_mul_ps(_mm256_loadu_ps(s.size + i), radiusScale);
+			__m256 negRadius = _mm256_sub_ps(zero, radius);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			__m256 nearDistance = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+					_mm256_add_ps(_mm256_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+				if (p == 4)
+				{
+					nearDistance = distance;
+				}
+			}
+			if (testSize)
+			{
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_mul_ps(radius, sizeFactor), nearDistance, _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			for (unsigned int k = 0; k < 8; ++k)
+			{
+				visible[numVisible] = i + k;
+				numVisible += (mask >> k) & 1;
+			}
+		}
+
+		_mm256_zeroupper();
+
+		return numVisible + cullParticlesScalar(s, v, i, end, visible + numVisible);
+	}
+#else
+	unsigned int cullParticlesSSE2(const CullStreams& s, const CullView& v, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		return cullParticlesScalar(s, v, begin, end, visible);
+	}
+
+	unsigned int cullParticlesAVX2(const CullStreams& s, const CullView& v, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		return cullParticlesScalar(s, v, begin, end, visible);
+	}
+#endif
+
+	namespace
+	{
+		// chosen once, the first time a kernel is needed
+		struct KernelTable
+		{
+			KernelTable()
+			{
+				level = detectSimdLevel();
+
+				switch (level)
+				{
+				case SIMD_AVX2:
+					integrate = integrateParticlesAVX2;
+					collide = collideParticlesSSE2; // collision is bound by the few particles that hit, wider tests gain little
+					sampleField = applyVectorFieldAVX2;
+					cull = cullParticlesAVX2;
+					break;
+				case SIMD_SSE2:
+					integrate = integrateParticlesSSE2;
+					collide = collideParticlesSSE2;
+					sampleField = applyVectorFieldSSE2;
+					cull = cullParticlesSSE2;
+					break;
+				default:
+					integrate = integrateParticlesScalar;
+					collide = collideParticlesScalar;
+					sampleField = applyVectorFieldScalar;
+					cull = cullParticlesScalar;
+					break;
+				}
+			}
+
+			SIMD_LEVEL level;
+			IntegrateKernel integrate;
+			CollideKernel collide;
+			VectorFieldKernel sampleField;
+			CullKernel cull;
+		};
+
+		const KernelTable& kernels()
+		{
+			static KernelTable table;
+			return table;
+		}
+	}
+
+	SIMD_LEVEL activeSimdLevel()
+	{
+		return kernels().level;
+	}
+
+	void integrateParticles(const IntegrationStreams& streams, unsigned int begin, unsigned int end, float dt)
+	{
+		kernels().integrate(streams, begin, end, dt);
+	}
+
+	void collideParticles(const CollisionStreams& streams, const ColliderShape& collider, unsigned int begin, unsigned int end)
+	{
+		kernels().collide(streams, collider, begin, end);
+	}
+
+	void applyVectorField(const VectorFieldStreams& streams, const VectorFieldSampler& field, unsigned int begin, unsigned int end)
+	{
+		kernels().sampleField(streams, field, begin, end);
+	}
+
+	unsigned int cullParticles(const CullStreams& streams, const CullView& view, unsigned int begin, unsigned int end, unsigned int* visible)
+	{
+		return kernels().cull(streams, view, begin, end, visible);
+	}
+
+	/*
+	 * @description times the dispatched collision kernel against a default collider of the given shape at the origin.
+	 * particles are spread over a cube a little bigger than the collider, so some but not all of them hit
+	 * @method benchmarkCollideKernel
+	 * @params {int} shape - a COLLIDER_SHAPE
+	 * @params {unsigned int} count - number of particles
+	 * @params {unsigned int} repeats - runs to take the fastest of
+	 * @return {float} milliseconds for one pass
+	 */
+	float benchmarkCollideKernel(int shape, unsigned int count, unsigned int repeats)
+	{
+		Collider collider;
+		collider.shape = shape;
+		ColliderShape prepared = prepareCollider(collider);
+
+		std::vector<float> data((size_t)count * 7);
+		std::vector<float> start(data.size());
+
+		unsigned int seed = 12345u;
+		for (size_t i = 0; i < start.size(); ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			start[i] = ((seed >> 8) * (1.0f / 16777216.0f)) * 8.0f - 4.0f;
+		}
+
+		CollisionStreams streams;
+		float* base = data.data();
+		streams.posX = base + 0 * (size_t)count;
+		streams.posY = base + 1 * (size_t)count;
+		streams.posZ = base + 2 * (size_t)count;
+		streams.velX = base + 3 * (size_t)count;
+		streams.velY = base + 4 * (size_t)count;
+		streams.velZ = base + 5 * (size_t)count;
+		streams.life = base + 6 * (size_t)count;
+
+		double best = 0.0;
+		for (unsigned int r = 0; r < repeats; ++r)
+		{
+			std::copy(start.begin(), start.end(), data.begin()); // every run starts with the same particles inside
+
+			auto begin = std::chrono::high_resolution_clock::now();
+			collideParticles(streams, prepared, 0, count);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+			if (r == 0 || ms < best)
+			{
+				best = ms;
+			}
+		}
+
+		return (float)best;
+	}
+
+	/*
+	 * @description reads the high resolution clock
+	 * @method timeMilliseconds
+	 * @return {double} milliseconds since an arbitrary start, only differences mean anything
+	 */
+	double timeMilliseconds()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	}
+}
+
+#ifdef _M_CEE
+#pragma managed(pop)
+#endif
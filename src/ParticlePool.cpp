@@ -0,0 +1,234 @@
+#include "ParticlePool.h"
+#include <type_traits>
+#include <initializer_list>
+#include <cstring> // for memcpy
+
+ParticlePool::ParticlePool() : m_capacity(0), m_allocated(0), m_numAlive(0)
+{
+}
+
+ParticlePool::~ParticlePool()
+{
+	clear();
+}
+
+/*
+ * @description changes how many particles can be alive. the streams are only reallocated when capacity no longer fits,
+ * growing by half again so a run of small increases costs a few reallocations, or when it needs less than
+ * 1 / PARTICLE_POOL_SHRINK_RATIO of them. living particles are kept, except those at or past a smaller capacity
+ * @method setCapacity
+ * @params {unsigned int} capacity
+ * @return {void}
+ */
+void ParticlePool::setCapacity(unsigned int capacity)
+{
+	if (m_numAlive > capacity)
+	{
+		m_numAlive = capacity;
+	}
+
+	if (capacity > m_allocated)
+	{
+		unsigned int grown = m_allocated + m_allocated / 2;
+		reallocate(grown > capacity ? grown : capacity);
+	}
+	else if ((uint64_t)capacity * PARTICLE_POOL_SHRINK_RATIO < m_allocated)
+	{
+		reallocate(capacity);
+	}
+
+	m_capacity = capacity;
+}
+
+/*
+ * @description makes sure the streams have room for count particles, for callers that know how big an effect gets
+ * @method reserve
+ * @params {unsigned int} count
+ * @return {void}
+ */
+void ParticlePool::reserve(unsigned int count)
+{
+	if (count > m_allocated)
+	{
+		reallocate(count);
+	}
+}
+
+/*
+ * @description gives back whatever room capacity doesn't need
+ * @method shrinkToFit
+ * @return {void}
+ */
+void ParticlePool::shrinkToFit()
+{
+	if (m_allocated != m_capacity)
+	{
+		reallocate(m_capacity);
+	}
+}
+
+/*
+ * @description replaces every stream with one of exactly count particles. only the living particles are copied, the
+ * rest of the new streams are value initialized
+ * @method reallocate
+ * @params {unsigned int} count - at least numAlive
+ * @return {void}
+ */
+void ParticlePool::reallocate(unsigned int count)
+{
+	unsigned int numAlive = m_numAlive;
+	forEachStream([count, numAlive](auto& stream)
+	{
+		typedef typename std::decay<decltype(stream)>::type Stream;
+		Stream resized;
+		if (count > 0)
+		{
+			resized.reserve(count);
+			resized.assign(stream.begin(), stream.begin() + numAlive);
+			resized.resize(count);
+		}
+		resized.swap(stream);
+	});
+	m_allocated = count;
+}
+
+/*
+ * @description memory held by the streams
+ * @method bytesAllocated
+ * @return {size_t}
+ */
+size_t ParticlePool::bytesAllocated() const
+{
+	size_t bytes = 0;
+	forEachStream([&bytes](const auto& stream)
+	{
+		bytes += stream.capacity() * sizeof(stream[0]);
+	});
+	return bytes;
+}
+
+/*
+ * @description frees every particle stream
+ * @method clear
+ * @return {void}
+ */
+void ParticlePool::clear()
+{
+	m_capacity = 0;
+	m_allocated = 0;
+	m_numAlive = 0;
+
+	forEachStream([](auto& stream)
+	{
+		// swap with an empty vector to actually release the memory
+		typename std::decay<decltype(stream)>::type().swap(stream);
+	});
+}
+
+/*
+ * @description copies every property of particle src over particle dst
+ * @method copyParticle
+ * @params {unsigned int} dst
+ * @params {unsigned int} src
+ * @return {void}
+ */
+void ParticlePool::copyParticle(unsigned int dst, unsigned int src)
+{
+	forEachStream([dst, src](auto& stream)
+	{
+		stream[dst] = stream[src];
+	});
+}
+
+/*
+ * @description bytes saveState writes for a pool of capacity particles
+ * @method stateSize
+ * @params {unsigned int} capacity
+ * @return {size_t}
+ */
+size_t ParticlePool::stateSize(unsigned int capacity) const
+{
+	size_t bytes = sizeof(m_capacity) + sizeof(m_numAlive);
+	forEachStream([&bytes, capacity](const auto& stream)
+	{
+		bytes += (size_t)capacity * sizeof(stream[0]);
+	});
+	return bytes;
+}
+
+/*
+ * @description the capacity a state was saved with, which saveState writes first
+ * @method savedCapacity
+ * @params {const uint8_t *} in
+ * @return {unsigned int}
+ */
+unsigned int ParticlePool::savedCapacity(const uint8_t* in)
+{
+	unsigned int capacity;
+	memcpy(&capacity, in, sizeof(capacity));
+	return capacity;
+}
+
+/*
+ * @description writes the capacity, the number of living particles and then every stream, stateSize bytes in all
+ * @method saveState
+ * @params {uint8_t *} out
+ * @return {void}
+ */
+void ParticlePool::saveState(uint8_t* out) const
+{
+	memcpy(out, &m_capacity, sizeof(m_capacity));
+	out += sizeof(m_capacity);
+	memcpy(out, &m_numAlive, sizeof(m_numAlive));
+	out += sizeof(m_numAlive);
+
+	forEachStream([&out, this](const auto& stream)
+	{
+		size_t alive = (size_t)m_numAlive * sizeof(stream[0]);
+		size_t total = (size_t)m_capacity * sizeof(stream[0]);
+		memcpy(out, stream.data(), alive);
+		memset(out + alive, 0, total - alive);
+		out += total;
+	});
+}
+
+/*
+ * @description reads a state written by saveState, going back to the capacity it was saved with
+ * @method loadState
+ * @params {const uint8_t *} in
+ * @return {void}
+ */
+void ParticlePool::loadState(const uint8_t* in)
+{
+	setCapacity(savedCapacity(in));
+	in += sizeof(m_capacity);
+	memcpy(&m_numAlive, in, sizeof(m_numAlive));
+	in += sizeof(m_numAlive);
+
+	forEachStream([&in, this](auto& stream)
+	{
+		size_t total = (size_t)m_capacity * sizeof(stream[0]);
+		memcpy(stream.data(), in, total);
+		in += total;
+	});
+}
+
+/*
+ * @description sizes the buffer for capacity events
+ * @method reserve
+ * @params {unsigned int} capacity
+ * @return {void}
+ */
+void ParticleEventBuffer::reserve(unsigned int capacity)
+{
+	count = 0;
+	for (Vec3Stream* stream : { &position, &velocity })
+	{
+		stream->x.assign(capacity, 0.0f);
+		stream->y.assign(capacity, 0.0f);
+		stream->z.assign(capacity, 0.0f);
+		stream->x.shrink_to_fit();
+		stream->y.shrink_to_fit();
+		stream->z.shrink_to_fit();
+	}
+}
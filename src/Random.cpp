@@ -0,0 +1,60 @@
+#include "Random.h"
+
+#include <cstddef>
+
+namespace algomath
+{
+	/*
+	 * @description fills out with the first count uniforms of a stream. each philox call gives 4 numbers
+	 * @method fillUniform
+	 * @params {uint64_t} stream - which stream to read, e.g. a particle's spawn number
+	 * @params {float *} out - destination, count floats long
+	 * @params {unsigned int} count
+	 * @return {void}
+	 */
+	void CounterRandom::fillUniform(uint64_t stream, float* out, unsigned int count) const
+	{
+		// the counter is (block within the stream, stream low, stream high, 0). the second key word keeps seed 0 from being all zeroes
+		const uint32_t key[2] = { m_seed, 0x5EED5EEDu };
+		uint32_t counter[4] = { 0, (uint32_t)stream, (uint32_t)(stream >> 32), 0 };
+		uint32_t bits[4];
+
+		unsigned int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			philox4x32(counter, key, bits);
+			out[i + 0] = uintToUniform(bits[0]);
+			out[i + 1] = uintToUniform(bits[1]);
+			out[i + 2] = uintToUniform(bits[2]);
+			out[i + 3] = uintToUniform(bits[3]);
+			++counter[0];
+		}
+
+		if (i < count)
+		{
+			philox4x32(counter, key, bits);
+			for (unsigned int j = 0; i < count; ++i, ++j)
+			{
+				out[i] = uintToUniform(bits[j]);
+			}
+		}
+	}
+
+	/*
+	 * @description fills numbers for a run of consecutive streams in one call. streams don't depend on each other,
+	 * so the loop has no carried state and the blocks can be split across threads or vectorized freely
+	 * @method fillUniformBatch
+	 * @params {uint64_t} firstStream
+	 * @params {unsigned int} numStreams
+	 * @params {unsigned int} perStream - uniforms wanted from each stream
+	 * @params {float *} out - destination, numStreams * perStream floats long
+	 * @return {void}
+	 */
+	void CounterRandom::fillUniformBatch(uint64_t firstStream, unsigned int numStreams, unsigned int perStream, float* out) const
+	{
+		for (unsigned int s = 0; s < numStreams; ++s)
+		{
+			fillUniform(firstStream + s, out + (size_t)s * perStream, perStream);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#include "SimulationClock.h"
+
+#include <cmath>
+
+#define SIMULATION_MIN_STEP 0.0001f
+
+SimulationClock::SimulationClock(float fixedStep, unsigned int maxSubsteps)
+	: m_fixedStep(SIMULATION_DEFAULT_STEP),
+	m_maxSubsteps(maxSubsteps),
+	m_accumulator(0.0f),
+	m_simulatedTime(0.0f),
+	m_droppedTime(0.0f)
+{
+	setFixedStep(fixedStep);
+}
+
+/*
+ * @description accumulates frameTime and takes as many whole fixed steps out of it as allowed
+ * @method advance
+ * @params {float} frameTime - seconds since the last frame
+ * @return {unsigned int} number of fixed steps to simulate this frame
+ */
+unsigned int SimulationClock::advance(float frameTime)
+{
+	if (frameTime > 0.0f)
+	{
+		m_accumulator += frameTime;
+	}
+
+	unsigned int steps = 0;
+	while (m_accumulator >= m_fixedStep && steps < m_maxSubsteps)
+	{
+		m_accumulator -= m_fixedStep;
+		++steps;
+	}
+
+	if (m_accumulator >= m_fixedStep)
+	{
+		// hit the cap. keep the fraction so interpolation stays smooth, drop the rest
+		float keep = std::fmod(m_accumulator, m_fixedStep);
+		m_droppedTime += m_accumulator - keep;
+		m_accumulator = keep;
+	}
+
+	m_simulatedTime += steps * m_fixedStep;
+	return steps;
+}
+
+/*
+ * @description clears accumulated time, e.g. after loading a new effect
+ * @method reset
+ * @return {void}
+ */
+void SimulationClock::reset()
+{
+	m_accumulator = 0.0f;
+	m_simulatedTime = 0.0f;
+	m_droppedTime = 0.0f;
+}
+
+/*
+ * @description sets the length of one simulation step in seconds
+ * @method setFixedStep
+ * @params {float} fixedStep
+ * @return {void}
+ */
+void SimulationClock::setFixedStep(float fixedStep)
+{
+	m_fixedStep = (fixedStep < SIMULATION_MIN_STEP) ? SIMULATION_MIN_STEP : fixedStep;
+	if (m_accumulator >= m_fixedStep)
+	{
+		m_accumulator = 0.0f;
+	}
+}
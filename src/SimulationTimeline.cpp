@@ -0,0 +1,350 @@
+#include "SimulationTimeline.h"
+
+#define TIMELINE_MIN_ZERO_RUN 4 // shorter runs of unchanged bytes are cheaper left inside a literal
+
+namespace
+{
+	inline void writeVarint(std::vector<uint8_t>& out, size_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	inline size_t readVarint(const std::vector<uint8_t>& in, size_t& pos)
+	{
+		size_t value = 0;
+		unsigned int shift = 0;
+		while (pos < in.size())
+		{
+			uint8_t byte = in[pos++];
+			value |= (size_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				break;
+			}
+			shift += 7;
+		}
+		return value;
+	}
+}
+
+SimulationTimeline::SimulationTimeline()
+	: m_enabled(false),
+	m_interval(SIMULATION_TIMELINE_DEFAULT_INTERVAL),
+	m_budget(SIMULATION_TIMELINE_DEFAULT_BUDGET),
+	m_memoryUsed(0),
+	m_uncompressedSize(0),
+	m_lastStateValid(false)
+{
+}
+
+/*
+ * @description drops every checkpoint and frees their memory
+ * @method clear
+ * @return {void}
+ */
+void SimulationTimeline::clear()
+{
+	std::deque<Checkpoint>().swap(m_checkpoints);
+	std::vector<uint8_t>().swap(m_lastState);
+	std::vector<uint8_t>().swap(m_scratch);
+	m_lastStateValid = false;
+	m_memoryUsed = 0;
+	m_uncompressedSize = 0;
+}
+
+/*
+ * @description turns recording on or off. turning it off frees the checkpoints
+ * @method setEnabled
+ * @params {bool} enabled
+ * @return {void}
+ */
+void SimulationTimeline::setEnabled(bool enabled)
+{
+	m_enabled = enabled;
+	if (!enabled)
+	{
+		clear();
+	}
+}
+
+/*
+ * @description sets how many steps apart checkpoints are, which is also the most steps a seek has to simulate again
+ * @method setInterval
+ * @params {unsigned int} steps - at least 1
+ * @return {void}
+ */
+void SimulationTimeline::setInterval(unsigned int steps)
+{
+	if (steps < 1)
+	{
+		steps = 1;
+	}
+	if (steps != m_interval)
+	{
+		m_interval = steps;
+		clear();
+	}
+}
+
+/*
+ * @description sets the most memory the compressed checkpoints can take
+ * @method setMemoryBudget
+ * @params {size_t} bytes
+ * @return {void}
+ */
+void SimulationTimeline::setMemoryBudget(size_t bytes)
+{
+	m_budget = bytes;
+	fitBudget();
+}
+
+/*
+ * @description whether step is due a checkpoint
+ * @method wantsCheckpoint
+ * @params {uint64_t} step
+ * @return {bool}
+ */
+bool SimulationTimeline::wantsCheckpoint(uint64_t step) const
+{
+	if (!m_enabled)
+	{
+		return false;
+	}
+	return m_checkpoints.empty() || (step % m_interval == 0 && step > m_checkpoints.back().step);
+}
+
+/*
+ * @description adds a checkpoint, encoded against the newest one already stored
+ * @method record
+ * @params {uint64_t} step - simulation step the state was saved at
+ * @params {const std::vector<uint8_t>&} state
+ * @return {void}
+ */
+void SimulationTimeline::record(uint64_t step, const std::vector<uint8_t>& state)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	while (!m_checkpoints.empty() && m_checkpoints.back().step >= step)
+	{
+		m_memoryUsed -= m_checkpoints.back().delta.size();
+		m_uncompressedSize -= m_checkpoints.back().stateSize;
+		m_checkpoints.pop_back();
+		m_lastStateValid = false;
+	}
+
+	if (m_checkpoints.empty())
+	{
+		m_lastState.clear();
+	}
+	else if (!m_lastStateValid)
+	{
+		decode(m_checkpoints.size() - 1, m_lastState);
+	}
+
+	Checkpoint checkpoint;
+	checkpoint.step = step;
+	checkpoint.stateSize = state.size();
+	encodeDelta(m_lastState, state, checkpoint.delta);
+	checkpoint.delta.shrink_to_fit();
+
+	m_memoryUsed += checkpoint.delta.size();
+	m_uncompressedSize += checkpoint.stateSize;
+	m_checkpoints.push_back(std::move(checkpoint));
+
+	m_lastState = state;
+	m_lastStateValid = true;
+
+	fitBudget();
+}
+
+/*
+ * @description finds the newest checkpoint at or before step and decodes it
+ * @method restore
+ * @params {uint64_t} step - where the caller wants to be
+ * @params {uint64_t&} checkpointStep - set to the step the restored state was saved at
+ * @params {std::vector<uint8_t>&} state - set to the restored state
+ * @return {bool} false if there is no checkpoint that early
+ */
+bool SimulationTimeline::restore(uint64_t step, uint64_t& checkpointStep, std::vector<uint8_t>& state)
+{
+	size_t count = m_checkpoints.size();
+	while (count > 0 && m_checkpoints[count - 1].step > step)
+	{
+		--count;
+	}
+	if (count == 0)
+	{
+		return false;
+	}
+
+	size_t index = count - 1;
+	if (index == m_checkpoints.size() - 1 && m_lastStateValid)
+	{
+		state = m_lastState;
+	}
+	else
+	{
+		decode(index, state);
+	}
+	checkpointStep = m_checkpoints[index].step;
+	return true;
+}
+
+/*
+ * @description XORs state with base and run length encodes the result as (unchanged bytes, literal bytes) pairs.
+ * base counts as zero past its end, so the oldest checkpoint is encoded against an empty base
+ * @method encodeDelta
+ * @params {const std::vector<uint8_t>&} base
+ * @params {const std::vector<uint8_t>&} state
+ * @params {std::vector<uint8_t>&} out
+ * @return {void}
+ */
+void SimulationTimeline::encodeDelta(const std::vector<uint8_t>& base, const std::vector<uint8_t>& state, std::vector<uint8_t>& out)
+{
+	out.clear();
+	size_t n = state.size();
+	size_t baseSize = base.size();
+	auto changed = [&](size_t i) -> uint8_t
+	{
+		return state[i] ^ (i < baseSize ? base[i] : 0);
+	};
+
+	size_t i = 0;
+	while (i < n)
+	{
+		size_t zeroStart = i;
+		while (i < n && changed(i) == 0)
+		{
+			++i;
+		}
+		if (i == n)
+		{
+			break; // trailing unchanged bytes need no pair
+		}
+
+		// the literal runs until a long enough run of unchanged bytes, short ones are kept in it
+		size_t literalStart = i;
+		size_t literalEnd = i;
+		size_t j = i;
+		while (j < n)
+		{
+			if (changed(j) != 0)
+			{
+				literalEnd = ++j;
+				continue;
+			}
+
+			size_t runEnd = j;
+			while (runEnd < n && changed(runEnd) == 0 && runEnd - j < TIMELINE_MIN_ZERO_RUN)
+			{
+				++runEnd;
+			}
+			if (runEnd - j >= TIMELINE_MIN_ZERO_RUN || runEnd == n)
+			{
+				break;
+			}
+			j = runEnd;
+		}
+
+		writeVarint(out, literalStart - zeroStart);
+		writeVarint(out, literalEnd - literalStart);
+		for (size_t k = literalStart; k < literalEnd; ++k)
+		{
+			out.push_back(changed(k));
+		}
+		i = literalEnd;
+	}
+}
+
+/*
+ * @description resizes state to stateSize, zero filling, then XORs the delta's literals back in
+ * @method applyDelta
+ * @params {const std::vector<uint8_t>&} delta
+ * @params {size_t} stateSize
+ * @params {std::vector<uint8_t>&} state - the base on the way in, the checkpoint on the way out
+ * @return {void}
+ */
+void SimulationTimeline::applyDelta(const std::vector<uint8_t>& delta, size_t stateSize, std::vector<uint8_t>& state)
+{
+	state.resize(stateSize, 0);
+
+	size_t in = 0;
+	size_t out = 0;
+	while (in < delta.size())
+	{
+		out += readVarint(delta, in);
+		size_t length = readVarint(delta, in);
+		for (size_t k = 0; k < length && in < delta.size(); ++k, ++in, ++out)
+		{
+			if (out < stateSize)
+			{
+				state[out] ^= delta[in];
+			}
+		}
+	}
+}
+
+/*
+ * @description rebuilds the state of checkpoint index by applying every delta from the oldest one up
+ * @method decode
+ * @params {size_t} index
+ * @params {std::vector<uint8_t>&} state
+ * @return {void}
+ */
+void SimulationTimeline::decode(size_t index, std::vector<uint8_t>& state) const
+{
+	state.clear();
+	for (size_t i = 0; i <= index; ++i)
+	{
+		applyDelta(m_checkpoints[i].delta, m_checkpoints[i].stateSize, state);
+	}
+}
+
+/*
+ * @description drops the oldest checkpoint. the next one was encoded against it, so it is decoded and encoded again
+ * against nothing first
+ * @method dropOldest
+ * @return {void}
+ */
+void SimulationTimeline::dropOldest()
+{
+	if (m_checkpoints.size() > 1)
+	{
+		decode(1, m_scratch);
+
+		Checkpoint& next = m_checkpoints[1];
+		m_memoryUsed -= next.delta.size();
+		encodeDelta(std::vector<uint8_t>(), m_scratch, next.delta);
+		next.delta.shrink_to_fit();
+		m_memoryUsed += next.delta.size();
+	}
+	else
+	{
+		m_lastStateValid = false;
+	}
+
+	m_memoryUsed -= m_checkpoints.front().delta.size();
+	m_uncompressedSize -= m_checkpoints.front().stateSize;
+	m_checkpoints.pop_front();
+}
+
+/*
+ * @description drops the oldest checkpoints until the rest fit the budget. the newest is always kept
+ * @method fitBudget
+ * @return {void}
+ */
+void SimulationTimeline::fitBudget()
+{
+	while (m_memoryUsed > m_budget && m_checkpoints.size() > 1)
+	{
+		dropOldest();
+	}
+}
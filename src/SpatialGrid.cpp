@@ -0,0 +1,78 @@
+#include "SpatialGrid.h"
+
+namespace algomath
+{
+	/*
+	 * @description buckets count points by cell with a counting sort: count the points in every bucket, turn the counts
+	 * into start offsets, then scatter the points to their slots. two passes over the points, no comparisons
+	 * @method build
+	 * @params {const float *} x, y, z - point positions
+	 * @params {const float *} vx, vy, vz - point velocities, copied alongside the positions
+	 * @params {unsigned int} count - number of points
+	 * @params {float} cellSize - edge length of a cell, and the largest radius a query can use
+	 * @params {bool} mortonOrder - hash cells in morton order instead of with the prime hash
+	 * @return {void}
+	 */
+	void SpatialGrid::build(const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz,
+		unsigned int count, float cellSize, bool mortonOrder)
+	{
+		m_cellSize = (cellSize < SPATIAL_GRID_MIN_CELL_SIZE) ? SPATIAL_GRID_MIN_CELL_SIZE : cellSize;
+		m_inverseCellSize = 1.0f / m_cellSize;
+		m_mortonOrder = mortonOrder;
+
+		unsigned int numBuckets = 64;
+		while (numBuckets < count * 2)
+		{
+			numBuckets <<= 1;
+		}
+		m_bucketMask = numBuckets - 1;
+
+		m_bucketStart.assign((size_t)numBuckets + 1, 0);
+		m_pointBucket.resize(count);
+		m_indices.resize(count);
+		m_x.resize(count); m_y.resize(count); m_z.resize(count);
+		m_vx.resize(count); m_vy.resize(count); m_vz.resize(count);
+
+		// count, shifted up by one so the prefix sum leaves each bucket's start in place
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int bucket = bucketOf(cellCoord(x[i]), cellCoord(y[i]), cellCoord(z[i]));
+			m_pointBucket[i] = bucket;
+			++m_bucketStart[bucket + 1];
+		}
+
+		for (unsigned int b = 0; b < numBuckets; ++b)
+		{
+			m_bucketStart[b + 1] += m_bucketStart[b];
+		}
+
+		// scatter. uses the start offsets as write cursors, then shifts them back afterwards
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int slot = m_bucketStart[m_pointBucket[i]]++;
+			m_indices[slot] = i;
+			m_x[slot] = x[i]; m_y[slot] = y[i]; m_z[slot] = z[i];
+			m_vx[slot] = vx[i]; m_vy[slot] = vy[i]; m_vz[slot] = vz[i];
+		}
+
+		for (unsigned int b = numBuckets; b > 0; --b)
+		{
+			m_bucketStart[b] = m_bucketStart[b - 1];
+		}
+		m_bucketStart[0] = 0;
+	}
+
+	/*
+	 * @description empties the grid, keeping its memory
+	 * @method clear
+	 * @return {void}
+	 */
+	void SpatialGrid::clear()
+	{
+		m_bucketStart.clear();
+		m_pointBucket.clear();
+		m_indices.clear();
+		m_x.clear(); m_y.clear(); m_z.clear();
+		m_vx.clear(); m_vy.clear(); m_vz.clear();
+	}
+}
@@ -0,0 +1,183 @@
+#include "ThreadPool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+namespace
+{
+	// set on the workers and on a thread while it runs a parallelFor, a parallelFor started from there runs serially.
+	// the calling thread holds jobMutex by then, so it can't be asked for again
+	thread_local bool insideParallelFor = false;
+}
+
+struct ThreadPool::Impl
+{
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake; // signalled when a new job is posted or the pool shuts down
+	std::condition_variable done; // signalled when the last worker leaves a job
+	unsigned long long generation = 0; // bumped once per job so workers can tell a new job from a spurious wake up
+	unsigned int busyWorkers = 0;
+	bool stopping = false;
+
+	std::mutex jobMutex; // held by whoever currently owns the workers
+	const std::function<void(unsigned int)>* task = nullptr;
+	unsigned int count = 0;
+	std::atomic<unsigned int> next;
+
+	// hands out loop indices until there are none left. shared by the workers and the calling thread
+	void runTask()
+	{
+		unsigned int i;
+		while ((i = next.fetch_add(1)) < count)
+		{
+			(*task)(i);
+		}
+	}
+
+	void workerLoop()
+	{
+		unsigned long long seen = 0;
+		insideParallelFor = true;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+
+				if (stopping)
+				{
+					return;
+				}
+
+				seen = generation;
+			}
+
+			runTask();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busyWorkers == 0)
+				{
+					done.notify_one();
+				}
+			}
+		}
+	}
+};
+
+/*
+ * @description starts the worker threads
+ * @constructor
+ * @params {unsigned int} numWorkers - number of threads to start, 0 picks one per hardware thread minus the caller
+ */
+ThreadPool::ThreadPool(unsigned int numWorkers) : m_impl(new Impl)
+{
+	m_impl->next = 0;
+
+	if (numWorkers == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+	}
+
+	m_impl->workers.reserve(numWorkers);
+	for (unsigned int i = 0; i < numWorkers; ++i)
+	{
+		m_impl->workers.emplace_back(&Impl::workerLoop, m_impl);
+	}
+}
+
+/*
+ * @description stops and joins the worker threads
+ * @destructor
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_impl->mutex);
+		m_impl->stopping = true;
+	}
+	m_impl->wake.notify_all();
+
+	for (auto& worker : m_impl->workers)
+	{
+		worker.join();
+	}
+
+	delete m_impl;
+}
+
+/*
+ * @description returns the pool shared by the whole program
+ * @method global
+ * @return {ThreadPool&}
+ */
+ThreadPool& ThreadPool::global()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+/*
+ * @description number of worker threads, not counting the thread that calls parallelFor
+ * @method numWorkers
+ * @return {unsigned int}
+ */
+unsigned int ThreadPool::numWorkers() const
+{
+	return (unsigned int)m_impl->workers.size();
+}
+
+/*
+ * @description runs task over [0, count) across the workers and the calling thread, blocking until it has all finished
+ * @method parallelFor
+ * @params {unsigned int} count - number of loop iterations
+ * @params {const std::function<void(unsigned int)>&} task - called once per iteration index
+ * @return {void}
+ */
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// nothing to share, called from inside a parallelFor, or the workers are busy with another thread's: just do it here
+	if (count == 1 || m_impl->workers.empty() || insideParallelFor || !m_impl->jobMutex.try_lock())
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_impl->mutex);
+		m_impl->task = &task;
+		m_impl->count = count;
+		m_impl->next = 0;
+		m_impl->busyWorkers = (unsigned int)m_impl->workers.size();
+		++m_impl->generation;
+	}
+	m_impl->wake.notify_all();
+
+	insideParallelFor = true;
+	m_impl->runTask();
+	insideParallelFor = false;
+
+	{
+		// every worker has to check in before task goes out of scope
+		std::unique_lock<std::mutex> lock(m_impl->mutex);
+		m_impl->done.wait(lock, [this] { return m_impl->busyWorkers == 0; });
+		m_impl->task = nullptr;
+	}
+
+	m_impl->jobMutex.unlock();
+}
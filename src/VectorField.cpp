@@ -0,0 +1,329 @@
+#include "VectorField.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace algomath
+{
+	namespace
+	{
+		// integer hash of a lattice point to [-1, 1]
+		inline float latticeValue(int x, int y, int z, uint32_t seed)
+		{
+			uint32_t h = seed;
+			h ^= (uint32_t)x * 0x8DA6B343u;
+			h ^= (uint32_t)y * 0xD8163841u;
+			h ^= (uint32_t)z * 0xCB1AB31Fu;
+			h ^= h >> 16;
+			h *= 0x7FEB352Du;
+			h ^= h >> 15;
+			h *= 0x846CA68Bu;
+			h ^= h >> 16;
+			return (h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+		}
+
+		inline float fade(float t)
+		{
+			return t * t * (3.0f - 2.0f * t);
+		}
+
+		// smoothly interpolated value noise
+		float valueNoise(float x, float y, float z, uint32_t seed)
+		{
+			float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+			int ix = (int)fx, iy = (int)fy, iz = (int)fz;
+			float tx = fade(x - fx), ty = fade(y - fy), tz = fade(z - fz);
+
+			float result = 0.0f;
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				int dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+				float weight = (dx ? tx : 1.0f - tx) * (dy ? ty : 1.0f - ty) * (dz ? tz : 1.0f - tz);
+				result += weight * latticeValue(ix + dx, iy + dy, iz + dz, seed);
+			}
+			return result;
+		}
+	}
+
+	VectorField::VectorField()
+		: m_x(nullptr),
+		m_y(nullptr),
+		m_z(nullptr),
+		m_view(nullptr),
+		m_viewSize(0)
+	{
+		m_size[0] = m_size[1] = m_size[2] = 0;
+	}
+
+	VectorField::~VectorField()
+	{
+		unload();
+	}
+
+	/*
+	 * @description frees the generated data or unmaps the loaded file
+	 * @method unload
+	 * @return {void}
+	 */
+	void VectorField::unload()
+	{
+		if (m_view)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(m_view);
+#else
+			munmap(const_cast<void*>(m_view), m_viewSize);
+#endif
+			m_view = nullptr;
+			m_viewSize = 0;
+		}
+
+		m_generated.clear();
+		m_generated.shrink_to_fit();
+		m_x = m_y = m_z = nullptr;
+		m_size[0] = m_size[1] = m_size[2] = 0;
+	}
+
+	bool VectorField::setSize(unsigned int sizeX, unsigned int sizeY, unsigned int sizeZ)
+	{
+		if (sizeX < VECTOR_FIELD_MIN_SIZE || sizeY < VECTOR_FIELD_MIN_SIZE || sizeZ < VECTOR_FIELD_MIN_SIZE ||
+			(uint64_t)sizeX * sizeY * sizeZ > VECTOR_FIELD_MAX_CELLS)
+		{
+			return false;
+		}
+
+		m_size[0] = sizeX;
+		m_size[1] = sizeY;
+		m_size[2] = sizeZ;
+		return true;
+	}
+
+	/*
+	 * @description fills the field with curl noise. the curl of any potential has no divergence, so particles swirl
+	 * around instead of bunching up at sinks. the largest vector is scaled to length 1
+	 * @method generateCurlNoise
+	 * @params {unsigned int} size - samples along each axis
+	 * @params {float} frequency - noise cells across the field
+	 * @params {unsigned int} seed
+	 * @return {void}
+	 */
+	void VectorField::generateCurlNoise(unsigned int size, float frequency, unsigned int seed)
+	{
+		unload();
+		if (size < VECTOR_FIELD_MIN_SIZE)
+		{
+			size = VECTOR_FIELD_MIN_SIZE;
+		}
+		while ((uint64_t)size * size * size > VECTOR_FIELD_MAX_CELLS)
+		{
+			--size;
+		}
+		setSize(size, size, size);
+
+		size_t numCells = (size_t)size * size * size;
+
+		// the potential, one noise per component, sampled at every grid point
+		std::vector<float> potential(numCells * 3);
+		float scale = frequency / (size - 1);
+		for (unsigned int z = 0; z < size; ++z)
+		{
+			for (unsigned int y = 0; y < size; ++y)
+			{
+				for (unsigned int x = 0; x < size; ++x)
+				{
+					size_t cell = ((size_t)z * size + y) * size + x;
+					for (unsigned int c = 0; c < 3; ++c)
+					{
+						potential[c * numCells + cell] = valueNoise(x * scale, y * scale, z * scale, seed + c * 0x9E3779B9u);
+					}
+				}
+			}
+		}
+
+		// curl by central differences, one sided at the faces
+		m_generated.assign(numCells * 3, 0.0f);
+		const size_t stride[3] = { 1, size, (size_t)size * size };
+		float longest2 = 0.0f;
+
+		for (unsigned int z = 0; z < size; ++z)
+		{
+			for (unsigned int y = 0; y < size; ++y)
+			{
+				for (unsigned int x = 0; x < size; ++x)
+				{
+					const unsigned int coord[3] = { x, y, z };
+					size_t cell = ((size_t)z * size + y) * size + x;
+
+					// derivative[c][a] is d(potential c) / d(axis a)
+					float derivative[3][3];
+					for (unsigned int a = 0; a < 3; ++a)
+					{
+						size_t lo = (coord[a] > 0) ? cell - stride[a] : cell;
+						size_t hi = (coord[a] + 1 < size) ? cell + stride[a] : cell;
+						float span = (float)((coord[a] + 1 < size ? 1 : 0) + (coord[a] > 0 ? 1 : 0));
+						for (unsigned int c = 0; c < 3; ++c)
+						{
+							derivative[c][a] = (potential[c * numCells + hi] - potential[c * numCells + lo]) / span;
+						}
+					}
+
+					float vx = derivative[2][1] - derivative[1][2];
+					float vy = derivative[0][2] - derivative[2][0];
+					float vz = derivative[1][0] - derivative[0][1];
+					m_generated[cell] = vx;
+					m_generated[numCells + cell] = vy;
+					m_generated[2 * numCells + cell] = vz;
+
+					float length2 = vx * vx + vy * vy + vz * vz;
+					if (length2 > longest2)
+					{
+						longest2 = length2;
+					}
+				}
+			}
+		}
+
+		if (longest2 > 0.0f)
+		{
+			float normalize = 1.0f / std::sqrt(longest2);
+			for (float& v : m_generated)
+			{
+				v *= normalize;
+			}
+		}
+
+		m_x = m_generated.data();
+		m_y = m_x + numCells;
+		m_z = m_y + numCells;
+	}
+
+	/*
+	 * @description memory-maps a .vfld file. nothing is read up front, pages come in as particles sample them
+	 * @method loadFromFile
+	 * @params {const std::string&} path
+	 * @return {bool} false if the file could not be mapped or is not a valid .vfld
+	 */
+	bool VectorField::loadFromFile(const std::string& path)
+	{
+		unload();
+
+		const void* view = nullptr;
+		size_t viewSize = 0;
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			printf("Vector field: could not open %s\n", path.c_str());
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		viewSize = (size_t)fileSize.QuadPart;
+
+		HANDLE mapping = (viewSize > 0) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+		if (mapping)
+		{
+			view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping); // the view holds its own reference
+		}
+		CloseHandle(file);
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			printf("Vector field: could not open %s\n", path.c_str());
+			return false;
+		}
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			viewSize = (size_t)fileStat.st_size;
+			void* mapped = mmap(nullptr, viewSize, PROT_READ, MAP_PRIVATE, file, 0);
+			view = (mapped == MAP_FAILED) ? nullptr : mapped;
+		}
+		close(file);
+#endif
+
+		if (!view)
+		{
+			printf("Vector field: could not map %s\n", path.c_str());
+			return false;
+		}
+
+		m_view = view;
+		m_viewSize = viewSize;
+
+		const VectorFieldHeader* header = (const VectorFieldHeader*)view;
+		if (viewSize < sizeof(VectorFieldHeader) || header->magic != VECTOR_FIELD_MAGIC || header->version != VECTOR_FIELD_FILE_VERSION ||
+			!setSize(header->sizeX, header->sizeY, header->sizeZ))
+		{
+			printf("Vector field: %s is not a vector field file\n", path.c_str());
+			unload();
+			return false;
+		}
+
+		size_t numCells = (size_t)m_size[0] * m_size[1] * m_size[2];
+		if (viewSize < sizeof(VectorFieldHeader) + numCells * 3 * sizeof(float))
+		{
+			printf("Vector field: %s is truncated\n", path.c_str());
+			unload();
+			return false;
+		}
+
+		m_x = (const float*)(header + 1);
+		m_y = m_x + numCells;
+		m_z = m_y + numCells;
+		return true;
+	}
+
+	/*
+	 * @description writes the field as a .vfld file that loadFromFile can map
+	 * @method saveToFile
+	 * @params {const std::string&} path
+	 * @return {bool}
+	 */
+	bool VectorField::saveToFile(const std::string& path) const
+	{
+		if (!isLoaded())
+		{
+			return false;
+		}
+
+		std::ofstream file(path, std::ios::out | std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		VectorFieldHeader header;
+		header.magic = VECTOR_FIELD_MAGIC;
+		header.version = VECTOR_FIELD_FILE_VERSION;
+		header.sizeX = m_size[0];
+		header.sizeY = m_size[1];
+		header.sizeZ = m_size[2];
+		header.reserved = 0;
+
+		std::streamsize componentBytes = (std::streamsize)((size_t)m_size[0] * m_size[1] * m_size[2] * sizeof(float));
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)m_x, componentBytes);
+		file.write((const char*)m_y, componentBytes);
+		file.write((const char*)m_z, componentBytes);
+		return file.good();
+	}
+}
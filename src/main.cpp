@@ -13,6 +13,7 @@
 #include "ParticleEmitter.h"
 #include "NodeGrapher.h"
 #include "Path.h"
+#include "ParticleKernels.h"
 
 // Core Libraries (std::)
 #include <iostream>
@@ -54,8 +55,12 @@ int mouseButton;
 GameObject* parentObject = nullptr;
 //ParticleEmitter* activeEmitter;
 ParticleSystem* activeSystem;
+ParticleDrawList particleDrawList; // reused every frame
+bool cullParticles = true;
+float minParticleScreenSize = 0.0f; // share of the screen's height below which particles aren't drawn
 
 int currentEmitter = 0;
+bool simulationPaused = false; // the timeline can still be scrubbed while paused
 
 TTK::Camera camera;
 algomath::NodeGrapher grapher;
@@ -244,6 +249,286 @@ void SaveEmitterSystemFileBoost() {
 }
 
 
+// .pest files start with PEST_MAGIC and a version where older ones start with the emitter count. those older files hold
+// each emitter's Config blob and graphs and nothing else. what emitters gained since goes after the graphs, in the
+// order of the versions that added it
+#define PEST_MAGIC 0x54534550 // "PEST"
+#define PEST_VERSION 9 // 1 seed, 2 flocking, 3 colliders, 4 vector fields, 5 sub-emitters, 6 analytic motion, 7 level of detail, 8 auto capacity, 9 lodBoundsRadius dropped
+
+namespace
+{
+	// Config as it was when the .pest format was made, written raw. it keeps that layout so old files still load,
+	// everything Config gained since is written one field at a time after the graphs
+	struct PestConfigBlock
+	{
+		unsigned int numberOfParticles;
+		glm::vec3 rotationalVelocity;
+		glm::vec3 emitterOffset;
+		int emissionShape;
+		float emissionRate;
+		glm::vec3 boxSize;
+		float sphereRadius;
+		float frustumRadiusSpawn;
+		float frustumRadiusTarget;
+		float frustumHeight;
+		bool playing;
+		bool loop;
+		float loopDelay;
+		float duration;
+		bool parentTransforms;
+		bool followPath;
+		bool directFollowMode;
+		float lookAhead;
+		float pathRadius;
+		float pathPower;
+		bool seekingBehaviours;
+		bool steeringBehaviours;
+		glm::vec3 seekPoint, steerPoint, gravitatePoint, attractPoint, arrivePoint;
+		float seekForce;
+		float steerForce, steerMaxForce;
+		float gravitatePower, gravitateMaxForce;
+		float attractForce, attractRange;
+		float arriveForce, arriveRange, arriveMaxForce;
+		bool globalEffects;
+		glm::vec3 globalForceVector;
+		glm::vec3 globalAccelerationVector;
+		bool limitSpeedOverLifetime;
+		glm::vec2 initialSpeedLimitRange;
+		glm::vec2 finalSpeedLimitRange;
+		glm::vec2 initialSpeedRange;
+		glm::vec2 lifeRange;
+		bool sizeOverLifetime;
+		glm::vec2 sizeRangeBegin;
+		glm::vec2 sizeRangeEnd;
+		glm::vec2 massRange;
+		bool colourOverLifetime;
+		glm::vec4 colourBegin0;
+		glm::vec4 colourBegin1;
+		glm::vec4 colourEnd0;
+		glm::vec4 colourEnd1;
+		Transform transform;
+	};
+
+	// every field PestConfigBlock and Config share
+#define PEST_BLOCK_FIELDS(X) \
+	X(numberOfParticles) X(rotationalVelocity) X(emitterOffset) X(emissionShape) X(emissionRate) X(boxSize) \
+	X(sphereRadius) X(frustumRadiusSpawn) X(frustumRadiusTarget) X(frustumHeight) X(playing) X(loop) X(loopDelay) \
+	X(duration) X(parentTransforms) X(followPath) X(directFollowMode) X(lookAhead) X(pathRadius) X(pathPower) \
+	X(seekingBehaviours) X(steeringBehaviours) X(seekPoint) X(steerPoint) X(gravitatePoint) X(attractPoint) \
+	X(arrivePoint) X(seekForce) X(steerForce) X(steerMaxForce) X(gravitatePower) X(gravitateMaxForce) \
+	X(attractForce) X(attractRange) X(arriveForce) X(arriveRange) X(arriveMaxForce) X(globalEffects) \
+	X(globalForceVector) X(globalAccelerationVector) X(limitSpeedOverLifetime) X(initialSpeedLimitRange) \
+	X(finalSpeedLimitRange) X(initialSpeedRange) X(lifeRange) X(sizeOverLifetime) X(sizeRangeBegin) X(sizeRangeEnd) \
+	X(massRange) X(colourOverLifetime) X(colourBegin0) X(colourBegin1) X(colourEnd0) X(colourEnd1) X(transform)
+
+	void toPestBlock(const ParticleEmitter::Config& config, PestConfigBlock& block)
+	{
+#define X(field) block.field = config.field;
+		PEST_BLOCK_FIELDS(X)
+#undef X
+	}
+
+	void fromPestBlock(const PestConfigBlock& block, ParticleEmitter::Config& config)
+	{
+#define X(field) config.field = block.field;
+		PEST_BLOCK_FIELDS(X)
+#undef X
+	}
+
+	template<class T>
+	void writePestValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<class T>
+	void readPestValue(std::ifstream& file, T& value)
+	{
+		file.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	// bytes from where file is to its end, for checking a count read from it before anything is allocated for it
+	std::streamoff pestBytesLeft(std::ifstream& file)
+	{
+		std::streampos here = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff left = file.tellg() - here;
+		file.seekg(here);
+		return left;
+	}
+
+	void writePestTransform(std::ofstream& file, const Transform& transform)
+	{
+		writePestValue(file, transform.getPosition());
+		writePestValue(file, transform.getRotation());
+		writePestValue(file, transform.getScale());
+	}
+
+	void readPestTransform(std::ifstream& file, Transform& transform)
+	{
+		glm::vec3 position, rotation, scale;
+		readPestValue(file, position);
+		readPestValue(file, rotation);
+		readPestValue(file, scale);
+		transform.setPosition(position);
+		transform.setRotation(rotation);
+		transform.setScale(scale);
+		transform.update();
+	}
+
+	// what an emitter has that PestConfigBlock and the graphs don't, a block per version
+	void writePestEmitter(std::ofstream& file, ParticleEmitter* emitter)
+	{
+		const ParticleEmitter::Config& config = emitter->myConfig;
+
+		writePestValue(file, config.randomSeed);
+
+		writePestValue(file, config.flockingBehaviours);
+		writePestValue(file, config.mortonOrderGrid);
+		writePestValue(file, config.flockRadius);
+		writePestValue(file, config.separationRadius);
+		writePestValue(file, config.separationForce);
+		writePestValue(file, config.alignmentForce);
+		writePestValue(file, config.cohesionForce);
+		writePestValue(file, config.flockMaxForce);
+		writePestValue(file, config.flockMaxNeighbours);
+
+		int numColliders = emitter->myState.colliders.size();
+		writePestValue(file, numColliders);
+		file.write(reinterpret_cast<const char*>(emitter->myState.colliders.data()), numColliders * sizeof(algomath::Collider));
+
+		writePestValue(file, config.vectorFieldEffects);
+		writePestValue(file, config.vectorFieldMode);
+		writePestValue(file, config.vectorFieldStrength);
+		writePestValue(file, config.vectorFieldResolution);
+		writePestValue(file, config.vectorFieldFrequency);
+		writePestTransform(file, config.vectorFieldTransform);
+
+		int fieldFileLength = emitter->myState.vectorFieldFile.size();
+		writePestValue(file, fieldFileLength);
+		file.write(emitter->myState.vectorFieldFile.data(), fieldFileLength);
+
+		writePestValue(file, config.birthSubEmitter);
+		writePestValue(file, config.deathSubEmitter);
+		writePestValue(file, config.particlesPerEvent);
+		writePestValue(file, config.inheritVelocity);
+
+		writePestValue(file, config.analyticMotion);
+
+		writePestValue(file, config.lodEnabled);
+		writePestValue(file, config.lodMetric);
+		writePestValue(file, config.lodHysteresis);
+		for (const ParticleLodLevel& level : config.lodLevels)
+		{
+			writePestValue(file, level.distance);
+			writePestValue(file, level.screenSize);
+			writePestValue(file, level.emissionScale);
+			writePestValue(file, level.capacityScale);
+			writePestValue(file, level.updateInterval);
+			writePestValue(file, level.reducedBehaviours);
+		}
+
+		writePestValue(file, config.autoCapacity);
+	}
+
+	// reads what writePestEmitter wrote, for a file of version. false if the file is cut short or a count in it can't be right
+	bool readPestEmitter(std::ifstream& file, ParticleEmitter* emitter, int version)
+	{
+		ParticleEmitter::Config& config = emitter->myConfig;
+
+		if (version >= 1)
+		{
+			readPestValue(file, config.randomSeed);
+		}
+
+		if (version >= 2)
+		{
+			readPestValue(file, config.flockingBehaviours);
+			readPestValue(file, config.mortonOrderGrid);
+			readPestValue(file, config.flockRadius);
+			readPestValue(file, config.separationRadius);
+			readPestValue(file, config.separationForce);
+			readPestValue(file, config.alignmentForce);
+			readPestValue(file, config.cohesionForce);
+			readPestValue(file, config.flockMaxForce);
+			readPestValue(file, config.flockMaxNeighbours);
+		}
+
+		if (version >= 3)
+		{
+			int numColliders = 0;
+			readPestValue(file, numColliders);
+			if (!file || numColliders < 0 || numColliders > pestBytesLeft(file) / (std::streamoff)sizeof(algomath::Collider))
+			{
+				return false;
+			}
+			emitter->myState.colliders.resize(numColliders);
+			file.read(reinterpret_cast<char*>(emitter->myState.colliders.data()), numColliders * sizeof(algomath::Collider));
+		}
+
+		if (version >= 4)
+		{
+			readPestValue(file, config.vectorFieldEffects);
+			readPestValue(file, config.vectorFieldMode);
+			readPestValue(file, config.vectorFieldStrength);
+			readPestValue(file, config.vectorFieldResolution);
+			readPestValue(file, config.vectorFieldFrequency);
+			readPestTransform(file, config.vectorFieldTransform);
+
+			int fieldFileLength = 0;
+			readPestValue(file, fieldFileLength);
+			if (!file || fieldFileLength < 0 || fieldFileLength > pestBytesLeft(file))
+			{
+				return false;
+			}
+			emitter->myState.vectorFieldFile.resize(fieldFileLength);
+			file.read(&emitter->myState.vectorFieldFile[0], fieldFileLength);
+			emitter->myState.vectorField.reset();
+		}
+
+		if (version >= 5)
+		{
+			readPestValue(file, config.birthSubEmitter);
+			readPestValue(file, config.deathSubEmitter);
+			readPestValue(file, config.particlesPerEvent);
+			readPestValue(file, config.inheritVelocity);
+		}
+
+		if (version >= 6)
+		{
+			readPestValue(file, config.analyticMotion);
+		}
+
+		if (version >= 7)
+		{
+			readPestValue(file, config.lodEnabled);
+			readPestValue(file, config.lodMetric);
+			readPestValue(file, config.lodHysteresis);
+			if (version < 9)
+			{
+				float lodBoundsRadius; // the screen size metric measures the bounds now
+				readPestValue(file, lodBoundsRadius);
+			}
+			for (ParticleLodLevel& level : config.lodLevels)
+			{
+				readPestValue(file, level.distance);
+				readPestValue(file, level.screenSize);
+				readPestValue(file, level.emissionScale);
+				readPestValue(file, level.capacityScale);
+				readPestValue(file, level.updateInterval);
+				readPestValue(file, level.reducedBehaviours);
+			}
+		}
+
+		if (version >= 8)
+		{
+			readPestValue(file, config.autoCapacity);
+		}
+
+		return !file.fail();
+	}
+}
+
 /*
 * @description this method saves an emitter system to a text file
 * @method SaveEmitterSystemTextFile
@@ -264,16 +549,25 @@ void SaveEmitterSystemBinaryFile() {
 		if (textFile.is_open()) {
 			activeSystem->getEmitter(currentEmitter)->myState.path = grapher.getPath();
 
+			int magic = PEST_MAGIC;
+			int version = PEST_VERSION;
+			textFile.write((char*)&magic, sizeof(int));
+			textFile.write((char*)&version, sizeof(int));
+
 			int numEmitters = activeSystem->m_emitters.size();
 			textFile.write((char*)&numEmitters, sizeof(int));
 			for (int ix = 0; ix < activeSystem->m_emitters.size(); ix++) {
 				ParticleEmitter* emitter = activeSystem->m_emitters[ix];
-				textFile.write(reinterpret_cast<char*>(&emitter->myConfig), sizeof(ParticleEmitter::Config));
+				PestConfigBlock block;
+				toPestBlock(emitter->myConfig, block);
+				textFile.write(reinterpret_cast<char*>(&block), sizeof(PestConfigBlock));
 				//textFile.write(reinterpret_cast<char*>(&emitter->myState.transform), sizeof(Transform));
 				emitter->myState.path.Write(textFile);
 				emitter->myState.sizeGraph.Write(textFile);
 				emitter->myState.speedGraph.Write(textFile);
 				emitter->myState.colourGraph.Write(textFile);
+
+				writePestEmitter(textFile, emitter);
 			}
 
 			textFile.close();
@@ -310,22 +604,54 @@ void OpenEmitterSystemBinaryFile() {
 
 		std::ifstream textFile(outPath, std::ios::in, std::ios::binary);
 		if (textFile.is_open()) {
-			activeSystem->clearSystem();
-
+			int version = 0;
 			int numEmitters = 0;
 			textFile.read((char*)&numEmitters, sizeof(int));
+			if (numEmitters == PEST_MAGIC)
+			{
+				textFile.read((char*)&version, sizeof(int));
+				textFile.read((char*)&numEmitters, sizeof(int));
+			}
+
+			// checked before the current system is thrown away
+			if (!textFile || version < 0 || version > PEST_VERSION || numEmitters <= 0 || numEmitters > pestBytesLeft(textFile) / (std::streamoff)sizeof(PestConfigBlock))
+			{
+				printf("%s is not a particle system this editor can read\n", outPath);
+				textFile.close();
+				return;
+			}
+
+			activeSystem->clearSystem();
 			for (int ix = 0; ix < numEmitters; ix++) {
 				addEmitter();
 				ParticleEmitter* emitter = activeSystem->m_emitters[ix];
-				textFile.read(reinterpret_cast<char*>(&emitter->myConfig), sizeof(ParticleEmitter::Config));
+				PestConfigBlock block;
+				toPestBlock(emitter->myConfig, block);
+				textFile.read(reinterpret_cast<char*>(&block), sizeof(PestConfigBlock));
+				fromPestBlock(block, emitter->myConfig);
 				//textFile.read(reinterpret_cast<char*>(&emitter->myState.transform), sizeof(Transform));
-				emitter->setNumParticles(emitter->myConfig.numberOfParticles);
 
 				emitter->myState.path.Read(textFile);
 				emitter->myState.sizeGraph.Read(textFile);
 				emitter->myState.speedGraph.Read(textFile);
 				emitter->myState.colourGraph.Read(textFile);
+				emitter->bakeGraphs();
+
+				if (!textFile || !readPestEmitter(textFile, emitter, version))
+				{
+					// the half read emitter is dropped, the ones before it are kept
+					printf("%s is cut short or damaged, loaded %d of its %d emitters\n", outPath, ix, numEmitters);
+					activeSystem->removeEmitter();
+					break;
+				}
+				emitter->setNumParticles(emitter->myConfig.numberOfParticles);
+			}
+
+			if (activeSystem->numEmitters() == 0)
+			{
+				InitializeSystem();
 			}
+			currentEmitter = activeSystem->numEmitters() - 1;
 
 			textFile.close();
 		}
@@ -497,6 +823,129 @@ void showUI() {
 
 			ImGui::Checkbox("Relative transformations", &emitter->myConfig.parentTransforms);
 
+			float simulationRate = 1.0f / activeSystem->clock.getFixedStep();
+			if (ImGui::DragFloat("Simulation rate (Hz)", &simulationRate, 1.0f, 10.0f, 240.0f))
+			{
+				activeSystem->clock.setFixedStep(1.0f / simulationRate);
+				activeSystem->timeline.clear(); // checkpoints are numbered in steps of the old length
+			}
+			int maxSubsteps = (int)activeSystem->clock.getMaxSubsteps();
+			if (ImGui::SliderInt("Max steps per frame", &maxSubsteps, 1, 16))
+			{
+				activeSystem->clock.setMaxSubsteps((unsigned int)maxSubsteps);
+			}
+
+			// fast forwards so looping effects start out full, and shows what that costs against stepping at the simulation rate
+			static float prewarmSeconds = 2.0f;
+			static float prewarmCost = 0.0f;
+			static unsigned int prewarmStepsTaken = 0;
+			ImGui::DragFloat("Prewarm (s)", &prewarmSeconds, 0.1f, 0.0f, 60.0f);
+			ImGui::SameLine();
+			if (ImGui::Button("Prewarm"))
+			{
+				prewarmStepsTaken = activeSystem->prewarmSteps(prewarmSeconds);
+				prewarmCost = activeSystem->prewarm(prewarmSeconds);
+			}
+			if (prewarmStepsTaken > 0)
+			{
+				ImGui::Text("%.2f ms, %u steps instead of %u", prewarmCost, prewarmStepsTaken,
+					(unsigned int)std::ceil(prewarmSeconds / activeSystem->clock.getFixedStep()));
+			}
+
+			//****************************************************************************
+			if (ImGui::CollapsingHeader("Particle Budget"))
+			{
+				ParticleBudget& particleBudget = ParticleBudget::global();
+				ImGui::Checkbox("Enforce budget", &particleBudget.enabled);
+				int maxParticles = (int)particleBudget.maxParticles;
+				if (ImGui::DragInt("Particle cap", &maxParticles, 100.0f, 0, 10000000))
+				{
+					particleBudget.maxParticles = (unsigned int)std::max(maxParticles, 0);
+				}
+				ImGui::DragFloat("Simulation budget (ms)", &particleBudget.frameBudgetMs, 0.05f, 0.1f, 100.0f);
+				ImGui::InputInt("Priority of this effect", &activeSystem->budget.priority);
+				ImGui::Text("all effects: %.2f ms (%.2f average), %u particles", particleBudget.getFrameMs(),
+					particleBudget.getAverageMs(), particleBudget.getParticlesAlive());
+
+				// what every effect costs and how much the budget held it back
+				ImGui::Separator();
+				const std::vector<ParticleSystem*>& systems = ParticleSystem::allSystems();
+				for (size_t i = 0; i < systems.size(); ++i)
+				{
+					const ParticleBudgetState& state = systems[i]->budget;
+					ImGui::Text("%s%u: priority %d, %.2f ms, %u/%u particles", (systems[i] == activeSystem) ? "* effect " : "effect ",
+						(unsigned int)i, state.priority, state.averageMs, state.particlesAlive,
+						std::min(state.particleQuota, state.capacity));
+					ImGui::Text("    throttled %.0f%% (%.1f s so far), %llu spawns denied", state.throttle * 100.0f,
+						state.throttledTime, (unsigned long long)state.spawnsDenied);
+				}
+			}
+
+			//****************************************************************************
+			if (ImGui::CollapsingHeader("Particle Culling"))
+			{
+				ImGui::Checkbox("Cull particles", &cullParticles);
+				ImGui::DragFloat("Min screen size", &minParticleScreenSize, 0.0005f, 0.0f, 0.1f, "%.4f");
+				ImGui::Text("this emitter: %u drawn, %u culled", emitter->getNumDrawn(), emitter->getNumCulled());
+				ImGui::Text("all effects: %u drawn, %u culled", (unsigned int)particleDrawList.numInstances(),
+					(unsigned int)particleDrawList.numCulled());
+
+				// what whole emitters and systems are culled by
+				ParticleBounds emitterBounds = emitter->getBounds();
+				ParticleBounds systemBounds = activeSystem->getBounds();
+				if (!emitterBounds.empty())
+				{
+					ImGui::Text("emitter bounds: (%.1f, %.1f, %.1f) to (%.1f, %.1f, %.1f)%s", emitterBounds.min.x, emitterBounds.min.y,
+						emitterBounds.min.z, emitterBounds.max.x, emitterBounds.max.y, emitterBounds.max.z,
+						emitter->getNumAliveParticles() == 0 ? ", estimated" : "");
+				}
+				if (!systemBounds.empty())
+				{
+					ImGui::Text("effect bounds: (%.1f, %.1f, %.1f) to (%.1f, %.1f, %.1f)", systemBounds.min.x, systemBounds.min.y,
+						systemBounds.min.z, systemBounds.max.x, systemBounds.max.y, systemBounds.max.z);
+				}
+			}
+
+			//****************************************************************************
+			if (ImGui::CollapsingHeader("Timeline"))
+			{
+				SimulationTimeline& timeline = activeSystem->timeline;
+				float fixedStep = activeSystem->clock.getFixedStep();
+
+				bool recording = timeline.isEnabled();
+				if (ImGui::Checkbox("Record checkpoints", &recording))
+				{
+					timeline.setEnabled(recording);
+				}
+				ImGui::SameLine();
+				ImGui::Checkbox("Paused", &simulationPaused);
+
+				int interval = (int)timeline.getInterval();
+				if (ImGui::SliderInt("Steps between checkpoints", &interval, 1, 240))
+				{
+					timeline.setInterval((unsigned int)interval);
+				}
+				int budgetMB = (int)(timeline.getMemoryBudget() >> 20);
+				if (ImGui::SliderInt("Memory budget (MB)", &budgetMB, 1, 1024))
+				{
+					timeline.setMemoryBudget((size_t)budgetMB << 20);
+				}
+
+				if (timeline.numCheckpoints() > 0)
+				{
+					// anywhere from the oldest checkpoint to a little past the newest, so the effect can be played forward too
+					float time = activeSystem->getTime();
+					float first = timeline.firstStep() * fixedStep;
+					float last = (timeline.lastStep() + timeline.getInterval()) * fixedStep;
+					if (ImGui::SliderFloat("Time", &time, first, last))
+					{
+						activeSystem->seek(time);
+					}
+					ImGui::Text("%u checkpoints, %.2f MB (%.2f MB uncompressed)", (unsigned int)timeline.numCheckpoints(),
+						timeline.memoryUsed() / 1048576.0f, timeline.uncompressedSize() / 1048576.0f);
+				}
+			}
+
 			ImGui::Separator();
 
 			//****************************************************************************
@@ -521,9 +970,19 @@ void showUI() {
 			if (ImGui::CollapsingHeader("Emission Options"))
 			{
 				numParticleScale = emitter->getNumParticles();
-				if (ImGui::DragInt("Max particles", &numParticleScale))
+				if (ImGui::DragInt("Max particles", &numParticleScale, 1.0f, 0, PARTICLE_AUTO_CAPACITY_MAX))
+				{
+					emitter->setNumParticles((unsigned int)std::max(numParticleScale, 0)); // keeps the effect running
+				}
+				ImGui::Checkbox("Grow to fit emission", &emitter->myConfig.autoCapacity);
+				ImGui::SameLine();
+				ImGui::Text("(%u)", emitter->autoCapacity());
+				ImGui::Text("room for %u particles, %.2f MB", emitter->getNumAllocatedParticles(),
+					emitter->getParticleMemory() / (1024.0f * 1024.0f));
+				ImGui::SameLine();
+				if (ImGui::Button("Shrink to fit"))
 				{
-					emitter->setNumParticles(numParticleScale);
+					emitter->shrinkParticles();
 				}
 
 				ImGui::DragFloat("Duration", &emitter->myConfig.duration);
@@ -537,6 +996,13 @@ void showUI() {
 				}
 				ImGui::Separator();
 
+				int randomSeed = (int)emitter->myConfig.randomSeed;
+				if (ImGui::InputInt("Random seed", &randomSeed))
+				{
+					emitter->setRandomSeed((unsigned int)randomSeed);
+					emitter->killParticles();
+				}
+
 				ImGui::DragFloat("Emission rate", &emitter->myConfig.emissionRate);
 				if (ImGui::DragFloat2("life range", &(emitter->myConfig.lifeRange[0]), 0.1f, 100.f))
 				{
@@ -582,7 +1048,10 @@ void showUI() {
 				ImGui::Checkbox("Size over lifetime", &emitter->myConfig.sizeOverLifetime);
 				if (ImGui::Button("Open size graph"))
 				{
-					grapher.openGraphFile1f(emitter->myState.sizeGraph);
+					if (grapher.openGraphFile1f(emitter->myState.sizeGraph))
+					{
+						emitter->bakeGraphs();
+					}
 				}
 				ImGui::DragFloat2("starting size range", &(emitter->myConfig.sizeRangeBegin[0]));
 				ImGui::DragFloat2("ending size range", &(emitter->myConfig.sizeRangeEnd[0]));
@@ -595,7 +1064,10 @@ void showUI() {
 				ImGui::Checkbox("Colour over lifetime", &emitter->myConfig.colourOverLifetime);
 				if (ImGui::Button("Open colour graph"))
 				{
-					grapher.openGraphFile1f(emitter->myState.colourGraph);
+					if (grapher.openGraphFile1f(emitter->myState.colourGraph))
+					{
+						emitter->bakeGraphs();
+					}
 				}
 				ImGui::ColorEdit4("Start Color", &emitter->myConfig.colourBegin0[0]);
 				ImGui::ColorEdit4("Start Color Variance", &emitter->myConfig.colourBegin1[0]);
@@ -611,7 +1083,10 @@ void showUI() {
 				ImGui::Checkbox("Speed limit over lifetime", &emitter->myConfig.limitSpeedOverLifetime);
 				if (ImGui::Button("Open speed graph"))
 				{
-					grapher.openGraphFile1f(emitter->myState.speedGraph);
+					if (grapher.openGraphFile1f(emitter->myState.speedGraph))
+					{
+						emitter->bakeGraphs();
+					}
 				}
 				ImGui::DragFloat2("Initial Speed Limit Range", &(emitter->myConfig.initialSpeedLimitRange.x));
 				ImGui::DragFloat2("Final Speed Limit Range", &(emitter->myConfig.finalSpeedLimitRange.x));
@@ -650,9 +1125,223 @@ void showUI() {
 				ImGui::Checkbox("Uniform effects", &emitter->myConfig.globalEffects);
 				ImGui::DragFloat3("Force", &(emitter->myConfig.globalForceVector.x));
 				ImGui::DragFloat3("Acceleration", &(emitter->myConfig.globalAccelerationVector.x));
+				ImGui::Checkbox("Analytic motion", &emitter->myConfig.analyticMotion);
+				if (emitter->myConfig.analyticMotion)
+				{
+					// anything besides the uniform effects needs the particles' current state, so those emitters keep integrating
+					ImGui::Text(emitter->isAnalytic() ? "closed form, particles are not integrated" : "integrating, other behaviours are enabled");
+				}
 				///////////////////////
 			}
 
+			//************************************************************************
+			if (ImGui::CollapsingHeader("Colliders")) {
+				static const char* shapeNames = "plane\0sphere\0box\0capsule\0";
+				static const char* responseNames = "bounce\0kill\0";
+
+				if (ImGui::Button("add collider"))
+				{
+					emitter->myState.colliders.push_back(algomath::Collider());
+				}
+
+				for (size_t i = 0; i < emitter->myState.colliders.size(); ++i)
+				{
+					algomath::Collider& collider = emitter->myState.colliders[i];
+					std::string label = "Collider " + std::to_string(i) + " (" + algomath::colliderShapeName(collider.shape) + ")";
+					ImGui::PushID((int)i);
+					if (ImGui::TreeNode(label.c_str()))
+					{
+						ImGui::Combo("Shape", &collider.shape, shapeNames);
+						ImGui::Combo("Response", &collider.response, responseNames);
+						ImGui::DragFloat3("Position", &collider.position.x);
+						ImGui::DragFloat3("Rotation", &collider.rotation.x);
+						if (collider.shape == algomath::COLLIDER_BOX)
+						{
+							ImGui::DragFloat3("Half extents", &collider.halfExtents.x, 0.1f, 0.0f, 10000.0f);
+						}
+						if (collider.shape == algomath::COLLIDER_SPHERE || collider.shape == algomath::COLLIDER_CAPSULE)
+						{
+							ImGui::DragFloat("Radius", &collider.radius, 0.1f, 0.0f, 10000.0f);
+						}
+						if (collider.shape == algomath::COLLIDER_CAPSULE)
+						{
+							ImGui::DragFloat("Half length", &collider.halfLength, 0.1f, 0.0f, 10000.0f);
+						}
+						ImGui::SliderFloat("Bounce", &collider.bounce, 0.0f, 1.0f);
+						ImGui::SliderFloat("Friction", &collider.friction, 0.0f, 1.0f);
+
+						if (ImGui::Button("remove collider"))
+						{
+							emitter->myState.colliders.erase(emitter->myState.colliders.begin() + i);
+							ImGui::TreePop();
+							ImGui::PopID();
+							break;
+						}
+						ImGui::TreePop();
+					}
+					ImGui::PopID();
+				}
+
+				ImGui::Separator();
+
+				// cost of one collider over 100k particles with the kernel this cpu uses
+				static float colliderCost[algomath::NUM_COLLIDER_SHAPES] = {};
+				if (ImGui::Button("Benchmark colliders"))
+				{
+					for (int shape = 0; shape < algomath::NUM_COLLIDER_SHAPES; ++shape)
+					{
+						colliderCost[shape] = algomath::benchmarkCollideKernel(shape, 100000);
+					}
+				}
+				for (int shape = 0; shape < algomath::NUM_COLLIDER_SHAPES; ++shape)
+				{
+					ImGui::Text("%s: %.3f ms per 100k particles", algomath::colliderShapeName(shape), colliderCost[shape]);
+				}
+			}
+
+			//************************************************************************
+			if (ImGui::CollapsingHeader("Level of Detail")) {
+				ImGui::Checkbox("Level of detail", &emitter->myConfig.lodEnabled);
+				ImGui::SameLine();
+				ImGui::Text("(level %u)", emitter->getLodLevel());
+				ImGui::Combo("Metric", &emitter->myConfig.lodMetric, "distance\0screen size\0");
+				ImGui::SliderFloat("Hysteresis", &emitter->myConfig.lodHysteresis, 0.0f, 0.5f);
+
+				for (int i = 0; i < PARTICLE_LOD_LEVELS; ++i)
+				{
+					ParticleLodLevel& level = emitter->myConfig.lodLevels[i];
+					std::string label = "Level " + std::to_string(i);
+					ImGui::PushID(i);
+					if (ImGui::TreeNode(label.c_str()))
+					{
+						if (i > 0)
+						{
+							ImGui::DragFloat("Starts at distance", &level.distance, 1.0f, 0.0f, 100000.0f);
+							ImGui::DragFloat("Starts below screen size", &level.screenSize, 0.001f, 0.0f, 1.0f);
+						}
+						ImGui::SliderFloat("Emission scale", &level.emissionScale, 0.0f, 1.0f);
+						ImGui::SliderFloat("Capacity scale", &level.capacityScale, 0.0f, 1.0f);
+						int updateInterval = (int)level.updateInterval;
+						if (ImGui::SliderInt("Steps per update", &updateInterval, 1, 16))
+						{
+							level.updateInterval = (unsigned int)updateInterval;
+						}
+						ImGui::Checkbox("Reduced behaviours", &level.reducedBehaviours);
+						ImGui::TreePop();
+					}
+					ImGui::PopID();
+				}
+			}
+
+			//************************************************************************
+			if (ImGui::CollapsingHeader("Sub-emitters")) {
+				// indices into this system's emitters, -1 for none. an emitter can't be its own sub-emitter, so stepping onto
+				// this one skips past it
+				const char* linkLabels[2] = { "Birth sub-emitter", "Death sub-emitter" };
+				int* links[2] = { &emitter->myConfig.birthSubEmitter, &emitter->myConfig.deathSubEmitter };
+				for (int i = 0; i < 2; ++i)
+				{
+					int previous = *links[i];
+					if (ImGui::InputInt(linkLabels[i], links[i]) && *links[i] == currentEmitter)
+					{
+						*links[i] += (*links[i] > previous) ? 1 : -1;
+					}
+					*links[i] = glm::clamp(*links[i], -1, (int)activeSystem->numEmitters() - 1);
+					if (*links[i] == currentEmitter)
+					{
+						*links[i] = (previous != currentEmitter) ? previous : -1;
+					}
+				}
+
+				ImGui::Separator();
+				int particlesPerEvent = (int)emitter->myConfig.particlesPerEvent;
+				if (ImGui::InputInt("Particles per event", &particlesPerEvent))
+				{
+					emitter->myConfig.particlesPerEvent = (unsigned int)glm::max(particlesPerEvent, 1);
+				}
+				ImGui::SliderFloat("Inherit velocity", &emitter->myConfig.inheritVelocity, 0.0f, 1.0f);
+			}
+
+			//************************************************************************
+			if (ImGui::CollapsingHeader("Vector Field")) {
+				ImGui::Checkbox("Vector field", &emitter->myConfig.vectorFieldEffects);
+				ImGui::Combo("Field mode", &emitter->myConfig.vectorFieldMode, "force\0velocity\0");
+				ImGui::DragFloat("Field strength", &emitter->myConfig.vectorFieldStrength);
+
+				Transform& fieldTransform = emitter->myConfig.vectorFieldTransform;
+				glm::vec3 fieldPosition = fieldTransform.getPosition();
+				glm::vec3 fieldRotation = fieldTransform.getRotation();
+				glm::vec3 fieldScale = fieldTransform.getScale();
+				if (ImGui::DragFloat3("Field position", &fieldPosition.x))
+				{
+					fieldTransform.setPosition(fieldPosition);
+				}
+				if (ImGui::DragFloat3("Field rotation", &fieldRotation.x, 0.01f))
+				{
+					fieldTransform.setRotation(fieldRotation);
+				}
+				if (ImGui::DragFloat3("Field size", &fieldScale.x, 0.1f, 0.01f, 100000.0f))
+				{
+					fieldTransform.setScale(fieldScale);
+				}
+				ImGui::Separator();
+
+				ImGui::Text("Field: %s", emitter->myState.vectorFieldFile.empty() ? "curl noise" : emitter->myState.vectorFieldFile.c_str());
+				int resolution = (int)emitter->myConfig.vectorFieldResolution;
+				if (ImGui::SliderInt("Noise resolution", &resolution, VECTOR_FIELD_MIN_SIZE, 128))
+				{
+					emitter->myConfig.vectorFieldResolution = (unsigned int)resolution;
+				}
+				ImGui::DragFloat("Noise frequency", &emitter->myConfig.vectorFieldFrequency, 0.05f, 0.1f, 64.0f);
+				if (ImGui::Button("Generate curl noise"))
+				{
+					emitter->myState.vectorFieldFile.clear();
+					emitter->loadVectorField();
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Load .vfld"))
+				{
+					nfdchar_t *outPath = NULL;
+					std::string currentDirectory = GetProjectDirectory();
+					if (NFD_OpenDialog("vfld", currentDirectory.c_str(), &outPath) == NFD_OKAY)
+					{
+						emitter->myState.vectorFieldFile = outPath;
+						emitter->loadVectorField();
+					}
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Save .vfld") && emitter->myState.vectorField)
+				{
+					nfdchar_t *outPath = NULL;
+					std::string currentDirectory = GetProjectDirectory();
+					if (NFD_SaveDialog("vfld", currentDirectory.c_str(), &outPath) == NFD_OKAY)
+					{
+						emitter->myState.vectorField->saveToFile(outPath);
+					}
+				}
+			}
+
+			//************************************************************************
+			if (ImGui::CollapsingHeader("Flocking Behaviours")) {
+				ImGui::Checkbox("Flocking behaviours", &emitter->myConfig.flockingBehaviours);
+				ImGui::SameLine();
+				ImGui::Checkbox("Morton ordered grid", &emitter->myConfig.mortonOrderGrid);
+
+				ImGui::DragFloat("flockRadius", &emitter->myConfig.flockRadius, 0.1f, 0.01f, 1000.0f);
+				ImGui::DragFloat("separationRadius", &emitter->myConfig.separationRadius, 0.1f, 0.0f, 1000.0f);
+				ImGui::Separator();
+				ImGui::DragFloat("separationForce", &emitter->myConfig.separationForce);
+				ImGui::DragFloat("alignmentForce", &emitter->myConfig.alignmentForce);
+				ImGui::DragFloat("cohesionForce", &emitter->myConfig.cohesionForce);
+				ImGui::DragFloat("flockMaxForce", &emitter->myConfig.flockMaxForce);
+
+				int maxNeighbours = (int)emitter->myConfig.flockMaxNeighbours;
+				if (ImGui::DragInt("flockMaxNeighbours", &maxNeighbours, 1.0f, 0, 1024))
+				{
+					emitter->myConfig.flockMaxNeighbours = (unsigned int)maxNeighbours;
+				}
+			}
+
 			//************************************************************************
 			if (ImGui::CollapsingHeader("3D Spline Options")) {
 				
@@ -699,7 +1388,7 @@ void showUI() {
 					}
 				}
 
-				if (emitter->myState.path.m_data.size() >= 1) {
+				if (emitter->myState.path.numIntervals() >= 1) {
 					//***********************************************************************
 					if (ImGui::TreeNode("Path Options")) {
 						///////////////////// path following
@@ -745,7 +1434,7 @@ void showUI() {
 					}
 				}
 
-				if (grapher.m_table.m_data.size() >= 1) {
+				if (grapher.m_table.numIntervals() >= 1) {
 					ImGui::SameLine();
 					if (ImGui::Button("assign path"))
 					{
@@ -755,7 +1444,7 @@ void showUI() {
 					ImGui::SameLine();
 					if (ImGui::Button("clear path")) {
 						grapher.clearNodes();
-						grapher.m_table.m_data.clear();
+						grapher.m_table.clear();
 					}
 				}
 			}
@@ -791,8 +1480,32 @@ void Update(void)
 	torsoMesh->draw(worldMatrix);
 	
 
+	ParticleRenderView particleView;
+	particleView.cameraPosition = camera.cameraPosition;
+	particleView.viewMatrix = glm::lookAt(camera.cameraPosition, camera.cameraPosition + camera.forwardVector, camera.upVector);
+	particleView.projectionMatrix = glm::perspective(glm::radians(30.0f), (float)windowWidth / (float)windowHeight, 0.001f, 10000.0f); // matches SetCameraMode3D
+	particleView.cullParticles = cullParticles;
+	particleView.minScreenSize = minParticleScreenSize;
+
+	// the camera decides how much of each emitter gets simulated
+	ParticleSystem::selectLodAll(particleView);
+
+	// time since the last draw rather than the last timer tick, glut can draw more often than the timer fires and each
+	// interval must only be simulated once
+	static int elapsedTimeAtLastFrame = glutGet(GLUT_ELAPSED_TIME);
+	int totalElapsedTime = glutGet(GLUT_ELAPSED_TIME);
+	float frameTime = (totalElapsedTime - elapsedTimeAtLastFrame) / 1000.0f;
+	elapsedTimeAtLastFrame = totalElapsedTime;
+
+	// the system is a component of parentObject, so this simulates it
+	activeSystem->setFrameTime(simulationPaused ? 0.0f : frameTime);
 	parentObject->update();
-	activeSystem->update();
+	ParticleSystem::balanceBudget(frameTime);
+
+	// then every system's particles go into one list and get drawn together
+	particleDrawList.clear();
+	ParticleSystem::renderAll(particleView, particleDrawList);
+	particleDrawList.submit();
 
 	grapher.draw();
 
@@ -0,0 +1,427 @@
+// checks the SIMD particle kernels against their scalar versions, and the baked graph lookup tables against the graphs
+// they came from. returns the number of failed checks, so a build step or script can run it
+
+#include "ParticleKernels.h"
+#include "LookupTable.h"
+
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+
+#define INTEGRATE_KERNEL_TOLERANCE 1e-5f
+#define COLLIDE_KERNEL_TOLERANCE 1e-5f
+#define VECTOR_FIELD_KERNEL_TOLERANCE 1e-5f
+
+using namespace algomath;
+
+namespace
+{
+	/*
+	 * @description runs kernel and the scalar kernel over the same random particles and compares the results
+	 * @method validateIntegrateKernel
+	 * @params {IntegrateKernel} kernel
+	 * @params {unsigned int} count - number of particles, odd so the scalar tail gets exercised too
+	 * @return {float} largest relative difference found
+	 */
+	float validateIntegrateKernel(IntegrateKernel kernel, unsigned int count)
+	{
+		const unsigned int numStreams = 15;
+		std::vector<float> expected(count * numStreams);
+
+		// simple lcg so the check is the same every run
+		unsigned int seed = 12345u;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			expected[i] = ((seed >> 8) * (1.0f / 16777216.0f)) * 200.0f - 100.0f;
+		}
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			expected[12 * count + i] = 1.0f + std::fabs(expected[12 * count + i]); // mass
+			expected[14 * count + i] = std::fabs(expected[14 * count + i]); // speed limit
+		}
+
+		std::vector<float> actual = expected;
+
+		auto makeStreams = [count](std::vector<float>& data, bool limitSpeed, float* bounds)
+		{
+			IntegrationStreams s;
+			float* base = data.data();
+			s.posX = base + 0 * count;
+			s.posY = base + 1 * count;
+			s.posZ = base + 2 * count;
+			s.velX = base + 3 * count;
+			s.velY = base + 4 * count;
+			s.velZ = base + 5 * count;
+			s.accelX = base + 6 * count;
+			s.accelY = base + 7 * count;
+			s.accelZ = base + 8 * count;
+			s.forceX = base + 9 * count;
+			s.forceY = base + 10 * count;
+			s.forceZ = base + 11 * count;
+			s.mass = base + 12 * count;
+			s.life = base + 13 * count;
+			s.speedLimit = limitSpeed ? base + 14 * count : nullptr;
+			s.bounds = bounds;
+			return s;
+		};
+
+		float maxError = 0.0f;
+
+		// once with the speed limit, once without
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			bool limitSpeed = (pass == 0);
+			float expectedBounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			float actualBounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			integrateParticlesScalar(makeStreams(expected, limitSpeed, expectedBounds), 0, count, 0.016f);
+			kernel(makeStreams(actual, limitSpeed, actualBounds), 0, count, 0.016f);
+
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				float error = std::fabs(expected[i] - actual[i]) / std::max(1.0f, std::fabs(expected[i]));
+				maxError = std::max(maxError, error);
+			}
+			for (int i = 0; i < 6; ++i)
+			{
+				float error = std::fabs(expectedBounds[i] - actualBounds[i]) / std::max(1.0f, std::fabs(expectedBounds[i]));
+				maxError = std::max(maxError, error);
+			}
+		}
+
+		return maxError;
+	}
+
+	/*
+	 * @description runs validateIntegrateKernel for one kernel over a few particle counts, so the wide loops and their
+	 * scalar tails both get covered
+	 * @method testIntegrateKernel
+	 * @params {SIMD_LEVEL} level
+	 * @params {IntegrateKernel} kernel
+	 * @return {int} number of failed checks
+	 */
+	int testIntegrateKernel(SIMD_LEVEL level, IntegrateKernel kernel)
+	{
+		const unsigned int counts[] = { 1, 7, 64, 1027 };
+
+		int failures = 0;
+		for (unsigned int count : counts)
+		{
+			float error = validateIntegrateKernel(kernel, count);
+			bool passed = error <= INTEGRATE_KERNEL_TOLERANCE;
+			printf("%s integrate, %u particles: error %g %s\n", simdLevelName(level), count, error, passed ? "ok" : "FAILED");
+			if (!passed)
+			{
+				++failures;
+			}
+		}
+		return failures;
+	}
+
+	// the same lcg as validateIntegrateKernel, for filling particle streams with values in [low, high)
+	void fillRandom(float* data, size_t count, float low, float high, unsigned int& seed)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			data[i] = low + ((seed >> 8) * (1.0f / 16777216.0f)) * (high - low);
+		}
+	}
+
+	// largest difference between two runs over the same streams, relative to the value where it is bigger than 1
+	float maxRelativeError(const std::vector<float>& expected, const std::vector<float>& actual)
+	{
+		float maxError = 0.0f;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			float error = std::fabs(expected[i] - actual[i]) / std::max(1.0f, std::fabs(expected[i]));
+			maxError = std::max(maxError, error);
+		}
+		return maxError;
+	}
+
+	/*
+	 * @description runs a collide kernel and the scalar one over the same particles, for every shape and response,
+	 * and compares the streams they leave behind
+	 * @method testCollideKernel
+	 * @params {SIMD_LEVEL} level
+	 * @params {CollideKernel} kernel
+	 * @return {int} number of failed checks
+	 */
+	int testCollideKernel(SIMD_LEVEL level, CollideKernel kernel)
+	{
+		const unsigned int counts[] = { 1, 7, 64, 1027 };
+
+		int failures = 0;
+		for (int shape = 0; shape < NUM_COLLIDER_SHAPES; ++shape)
+		{
+			for (int response = 0; response < NUM_COLLISION_RESPONSES; ++response)
+			{
+				Collider collider;
+				collider.shape = shape;
+				collider.response = response;
+				collider.position = glm::vec3(0.25f, -0.5f, 0.1f);
+				collider.rotation = glm::vec3(20.0f, 35.0f, -10.0f);
+				collider.halfExtents = glm::vec3(1.5f, 1.0f, 0.75f);
+				collider.radius = 1.25f;
+				collider.halfLength = 0.8f;
+				ColliderShape prepared = prepareCollider(collider);
+
+				for (unsigned int count : counts)
+				{
+					// positions spread so some particles are inside the collider and some aren't
+					std::vector<float> expected(count * 7);
+					unsigned int seed = 12345u + count;
+					fillRandom(expected.data(), count * 3, -3.0f, 3.0f, seed);
+					fillRandom(expected.data() + count * 3, count * 3, -5.0f, 5.0f, seed);
+					fillRandom(expected.data() + count * 6, count, 0.5f, 2.0f, seed);
+					std::vector<float> actual = expected;
+
+					auto makeStreams = [count](std::vector<float>& data)
+					{
+						float* base = data.data();
+						CollisionStreams streams = { base, base + count, base + 2 * count, base + 3 * count, base + 4 * count, base + 5 * count, base + 6 * count };
+						return streams;
+					};
+
+					collideParticlesScalar(makeStreams(expected), prepared, 0, count);
+					kernel(makeStreams(actual), prepared, 0, count);
+
+					float error = maxRelativeError(expected, actual);
+					bool passed = error <= COLLIDE_KERNEL_TOLERANCE;
+					printf("%s collide %s %s, %u particles: error %g %s\n", simdLevelName(level), colliderShapeName(shape),
+						response == COLLISION_KILL ? "kill" : "bounce", count, error, passed ? "ok" : "FAILED");
+					if (!passed)
+					{
+						++failures;
+					}
+				}
+			}
+		}
+		return failures;
+	}
+
+	/*
+	 * @description runs a vector field kernel and the scalar one over the same particles, in both modes, and compares
+	 * the forces they add. the field's sides are all different lengths, so a mixed up stride shows
+	 * @method testVectorFieldKernel
+	 * @params {SIMD_LEVEL} level
+	 * @params {VectorFieldKernel} kernel
+	 * @return {int} number of failed checks
+	 */
+	int testVectorFieldKernel(SIMD_LEVEL level, VectorFieldKernel kernel)
+	{
+		const unsigned int counts[] = { 1, 7, 64, 1027 };
+		const int size[3] = { 9, 6, 5 };
+
+		unsigned int seed = 54321u;
+		std::vector<float> samples(size[0] * size[1] * size[2] * 3);
+		fillRandom(samples.data(), samples.size(), -2.0f, 2.0f, seed);
+
+		VectorFieldSampler field;
+		field.x = samples.data();
+		field.y = field.x + size[0] * size[1] * size[2];
+		field.z = field.y + size[0] * size[1] * size[2];
+		// particle space [-1, 1] to the grid, slightly sheared so every axis feeds every grid coordinate
+		for (int a = 0; a < 3; ++a)
+		{
+			field.size[a] = size[a];
+			float scale = 0.5f * (size[a] - 1);
+			for (int b = 0; b < 3; ++b)
+			{
+				field.toGrid[a][b] = (a == b) ? scale : 0.1f * scale;
+			}
+			field.toGrid[a][3] = scale;
+		}
+		field.strength = 1.5f;
+
+		int failures = 0;
+		for (int mode = 0; mode < NUM_VECTOR_FIELD_MODES; ++mode)
+		{
+			field.mode = mode;
+			for (unsigned int count : counts)
+			{
+				// positions reach past the field, so the inside test and the clamped corners are covered
+				std::vector<float> particles(count * 6);
+				fillRandom(particles.data(), count * 3, -1.3f, 1.3f, seed);
+				fillRandom(particles.data() + count * 3, count * 3, -4.0f, 4.0f, seed);
+
+				std::vector<float> expected(count * 3);
+				fillRandom(expected.data(), expected.size(), -1.0f, 1.0f, seed);
+				std::vector<float> actual = expected;
+
+				auto makeStreams = [count, &particles](std::vector<float>& forces)
+				{
+					const float* base = particles.data();
+					VectorFieldStreams streams = { base, base + count, base + 2 * count, base + 3 * count, base + 4 * count, base + 5 * count,
+						forces.data(), forces.data() + count, forces.data() + 2 * count };
+					return streams;
+				};
+
+				applyVectorFieldScalar(makeStreams(expected), field, 0, count);
+				kernel(makeStreams(actual), field, 0, count);
+
+				float error = maxRelativeError(expected, actual);
+				bool passed = error <= VECTOR_FIELD_KERNEL_TOLERANCE;
+				printf("%s vector field %s, %u particles: error %g %s\n", simdLevelName(level), mode == VECTOR_FIELD_VELOCITY ? "velocity" : "force",
+					count, error, passed ? "ok" : "FAILED");
+				if (!passed)
+				{
+					++failures;
+				}
+			}
+		}
+		return failures;
+	}
+
+	/*
+	 * @description runs a cull kernel and the scalar one over the same particles, with and without the screen size
+	 * test, and checks they find the same visible particles in the same order
+	 * @method testCullKernel
+	 * @params {SIMD_LEVEL} level
+	 * @params {CullKernel} kernel
+	 * @return {int} number of failed checks
+	 */
+	int testCullKernel(SIMD_LEVEL level, CullKernel kernel)
+	{
+		const unsigned int counts[] = { 1, 7, 64, 1027 };
+
+		// a 90 degree frustum looking down -z from the origin, near plane at 0.1 and far plane at 20
+		const float planes[6][4] = {
+			{ 1.0f, 0.0f, -1.0f, 0.0f },
+			{ -1.0f, 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 1.0f, -1.0f, 0.0f },
+			{ 0.0f, -1.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, -1.0f, -0.1f },
+			{ 0.0f, 0.0f, 1.0f, 20.0f }
+		};
+
+		CullView view;
+		for (int p = 0; p < 6; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				view.planes[p][c] = planes[p][c];
+			}
+		}
+		view.interpolation = 0.3f;
+		view.radiusScale = 0.5f;
+
+		int failures = 0;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			view.sizeFactor = (pass == 0) ? 0.0f : 20.0f;
+			for (unsigned int count : counts)
+			{
+				// spread around the frustum's sides and both ends, so every plane culls some of them
+				std::vector<float> particles(count * 7);
+				unsigned int seed = 777u + count;
+				fillRandom(particles.data(), count * 2, -16.0f, 16.0f, seed);
+				fillRandom(particles.data() + count * 2, count, -24.0f, 2.0f, seed);
+				fillRandom(particles.data() + count * 3, count * 2, -16.0f, 16.0f, seed);
+				fillRandom(particles.data() + count * 5, count, -24.0f, 2.0f, seed);
+				fillRandom(particles.data() + count * 6, count, 0.05f, 2.0f, seed);
+
+				const float* base = particles.data();
+				CullStreams streams = { base, base + count, base + 2 * count, base + 3 * count, base + 4 * count, base + 5 * count, base + 6 * count };
+
+				std::vector<unsigned int> expected(count), actual(count);
+				unsigned int expectedVisible = cullParticlesScalar(streams, view, 0, count, expected.data());
+				unsigned int actualVisible = kernel(streams, view, 0, count, actual.data());
+
+				bool passed = (expectedVisible == actualVisible) && std::equal(expected.begin(), expected.begin() + expectedVisible, actual.begin());
+				printf("%s cull%s, %u particles: %u of %u visible %s\n", simdLevelName(level), pass == 0 ? "" : " by screen size",
+					count, actualVisible, expectedVisible, passed ? "ok" : "FAILED");
+				if (!passed)
+				{
+					++failures;
+				}
+			}
+		}
+		return failures;
+	}
+
+	// a graph like NodeGrapher makes: intervals of entries with distanceAlongPath running from 0 to end
+	Path<float> makeGraph(float(*curve)(float), unsigned int numIntervals, unsigned int entriesPerInterval, float end)
+	{
+		Path<float> graph;
+		for (unsigned int interval = 0; interval < numIntervals; ++interval)
+		{
+			std::vector<NodeGraphTableEntry<float>> entries;
+			for (unsigned int i = 0; i < entriesPerInterval; ++i)
+			{
+				float t = (float)i / (entriesPerInterval - 1);
+				float x = end * (interval + t) / numIntervals;
+				entries.push_back(NodeGraphTableEntry<float>(curve(x), t, x));
+			}
+			graph.addInterval(entries.begin(), entries.end());
+		}
+		return graph;
+	}
+
+	float easeInOut(float x) { return x * x * (3.0f - 2.0f * x); }
+	float fadeOut(float x) { return 1.0f - x * x; }
+	float wave(float x) { return 0.5f + 0.5f * std::sin(x * 12.0f); }
+
+	/*
+	 * @description bakes a graph and checks the table stays within LOOKUP_TABLE_MAX_ERROR of it
+	 * @method testLookupTable
+	 * @params {const char *} name
+	 * @params {Path<float>&} graph
+	 * @return {int} number of failed checks
+	 */
+	int testLookupTable(const char* name, Path<float>& graph)
+	{
+		LookupTable table;
+		table.bake(graph);
+
+		float error = table.maxError(graph);
+		bool passed = error <= LOOKUP_TABLE_MAX_ERROR;
+		printf("lookup table, %s: error %g %s\n", name, error, passed ? "ok" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
+
+int main()
+{
+	int failures = 0;
+
+	// the scalar kernel is what the others are checked against, so only the wider ones this cpu can run are tested
+	SIMD_LEVEL supported = detectSimdLevel();
+	printf("cpu supports %s\n", simdLevelName(supported));
+	if (supported >= SIMD_SSE2)
+	{
+		failures += testIntegrateKernel(SIMD_SSE2, integrateParticlesSSE2);
+		failures += testCollideKernel(SIMD_SSE2, collideParticlesSSE2);
+		failures += testVectorFieldKernel(SIMD_SSE2, applyVectorFieldSSE2);
+		failures += testCullKernel(SIMD_SSE2, cullParticlesSSE2);
+	}
+	if (supported >= SIMD_AVX2)
+	{
+		failures += testIntegrateKernel(SIMD_AVX2, integrateParticlesAVX2);
+		failures += testVectorFieldKernel(SIMD_AVX2, applyVectorFieldAVX2);
+		failures += testCullKernel(SIMD_AVX2, cullParticlesAVX2);
+	}
+
+	Path<float> line = createDefaultTable<float>();
+	Path<float> ease = makeGraph(easeInOut, 4, 32, 1.0f);
+	Path<float> fade = makeGraph(fadeOut, 2, 64, 0.75f); // stops short of 1, past the end the table holds the last value
+	Path<float> ripple = makeGraph(wave, 8, 32, 1.0f);
+	failures += testLookupTable("line", line);
+	failures += testLookupTable("ease in out", ease);
+	failures += testLookupTable("fade out", fade);
+	failures += testLookupTable("wave", ripple);
+
+	if (failures == 0)
+	{
+		printf("all passed\n");
+	}
+	else
+	{
+		printf("%d failed\n", failures);
+	}
+	return failures;
+}